@@ -0,0 +1,69 @@
+#ifndef CSP_CSP_H
+#define CSP_CSP_H
+
+/**
+ * the C interface of libcsp. Functions that can fail return CSP_OK or CSP_ERROR; csp_solve returns 1 when the
+ * problem has a solution, 0 when it has none and CSP_ERROR when the problem is invalid
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CSP_OK 0
+#define CSP_ERROR (-1)
+
+#define CSP_CONSISTENCY_NONE 0
+#define CSP_CONSISTENCY_FORWARD_CHECKING 1
+
+typedef struct csp_problem csp_problem;
+typedef struct csp_solutions csp_solutions;
+
+/* receives the names and values of a solution, count of each, in the order they were assigned; return nonzero to
+ * get the next solution and 0 to stop */
+typedef int (*csp_solution_callback)(const char* names, const int* values, size_t count, void* user);
+
+csp_problem* csp_problem_create(void);
+void csp_problem_destroy(csp_problem* problem);
+
+int csp_add_variable(csp_problem* problem, char name, const int* values, size_t count);
+int csp_add_variable_range(csp_problem* problem, char name, int low, int high);
+
+/* one or more constraints in the text format of a constraint file */
+int csp_add_constraint(csp_problem* problem, const char* text);
+
+/* scope holds arity variable names and tuples holds tuple_count rows of arity values */
+int csp_add_table(csp_problem* problem, const char* scope, size_t arity, const int* tuples, size_t tuple_count);
+
+/* scope is a string of variable names, e.g. "ABC" */
+int csp_add_all_different(csp_problem* problem, const char* scope);
+
+/* csp_pop removes the variables and constraints added since the matching csp_push */
+int csp_push(csp_problem* problem);
+int csp_pop(csp_problem* problem);
+
+/* without a callback the search stops at the first solution */
+int csp_solve(const csp_problem* problem, int consistency, csp_solution_callback on_solution, void* user);
+
+int csp_count(const csp_problem* problem, int consistency, unsigned long long* count);
+
+/* the solutions of a problem one at a time, each csp_solutions_next going on with the search where the last one
+ * stopped. csp_solutions_next returns 1 and points names and values at the next solution, valid until the following
+ * call, or returns 0 when there are no more */
+csp_solutions* csp_solutions_create(const csp_problem* problem, int consistency);
+int csp_solutions_next(csp_solutions* solutions, const char** names, const int** values, size_t* count);
+void csp_solutions_destroy(csp_solutions* solutions);
+
+/* what made the last function that failed on this thread fail, e.g. "csp_add_constraint: cannot read constraint
+ * 'A ~ B'"; empty when none has */
+const char* csp_last_error(void);
+
+const char* csp_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
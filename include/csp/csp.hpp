@@ -0,0 +1,214 @@
+#ifndef CSP_CSP_HPP
+#define CSP_CSP_HPP
+
+/**
+ * the C++ interface of libcsp: build a problem in memory, solve it and receive its solutions through a callback or a
+ * generator. Variables are named by a single character, like in the files read by the command line solver, and
+ * constraints are written in the same text format
+ */
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace csp {
+
+enum class Consistency {
+    None,               // check every value against the assignment only
+    ForwardChecking     // also remove the values of the unassigned variables that the assignment rules out
+};
+
+struct SolverOptions {
+    Consistency consistency = Consistency::ForwardChecking;
+    // domains with more values than this are split in two instead of being branched on value by value
+    long long split_threshold = 1024;
+    // replace cliques of != constraints by all-different constraints
+    bool detect_alldiff = false;
+    // propagate all-different constraints on their bounds instead of with a matching
+    bool alldiff_bounds = false;
+    // count() caches the counts of independent components in at most this many bytes; 0 counts by enumeration
+    size_t count_cache_bytes = 0;
+    // every search stops after this many seconds; 0 lets it run to the end
+    double time_limit = 0;
+};
+
+// the values of a solution, in the order the search assigned them
+using Assignment = std::vector<std::pair<char, int>>;
+
+// receives every solution; the search goes on while it returns true
+using SolutionCallback = std::function<bool(const Assignment&)>;
+
+struct SolveResult {
+    bool satisfiable = false;
+    unsigned long long solutions = 0;
+    long long nodes = 0;
+    double seconds = 0;
+    // the time limit ended the search before it was done
+    bool timed_out = false;
+    // from optimize(): the objective of the best solution found, which is optimal if the search was not stopped
+    long long objective = 0;
+    bool optimal = false;
+};
+
+class Problem {
+public:
+    Problem();
+    ~Problem();
+    Problem(const Problem& other);
+    Problem(Problem&& other) noexcept;
+    Problem& operator=(const Problem& other);
+    Problem& operator=(Problem&& other) noexcept;
+
+    /**
+     * the variables: a variable added again replaces its domain.
+     * Throws std::invalid_argument when the range is empty
+     */
+    void add_variable(char name, const std::vector<int>& values);
+    void add_variable(char name, int low, int high);
+
+    /**
+     * one or more constraints in the text format of a constraint file, e.g. "A > B + 2", "A + 2*B - C <= 10",
+     * "alldiff A B C", a "table ... end" section or the objective "minimize 2*A + B". Throws std::invalid_argument
+     * when a line cannot be read, adding none of them
+     */
+    void add_constraint(const std::string& text);
+
+    // the tuples of values that the variables of scope may take together
+    void add_table(const std::vector<char>& scope, const std::vector<std::vector<int>>& tuples);
+
+    void add_all_different(const std::vector<char>& scope);
+
+    /**
+     * scopes for editing a problem between solves: pop() takes back every variable and constraint added since the
+     * matching push(). Throws std::logic_error when there is no scope to pop
+     */
+    void push();
+    void pop();
+    size_t scopes() const;
+
+    /**
+     * a problem read from the contents of a variable file and a constraint file.
+     * Throws std::invalid_argument when a line of either cannot be read
+     */
+    static Problem parse(const std::string& variables, const std::string& constraints);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+    friend class Solver;
+};
+
+/**
+ * the solutions of a problem, searched for one at a time: next() goes on from where the last solution was found, so a
+ * caller that stops early never pays for the rest of the search. Also usable in a range-based for loop
+ */
+class SolutionGenerator {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Assignment;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Assignment*;
+        using reference = const Assignment&;
+
+        iterator() = default;
+        explicit iterator(SolutionGenerator* generator) : generator(generator) {}
+
+        reference operator*() const { return generator->value(); }
+        pointer operator->() const { return &generator->value(); }
+
+        iterator& operator++()
+        {
+            if (!generator->next())
+            {
+                generator = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return generator == other.generator; }
+        bool operator!=(const iterator& other) const { return generator != other.generator; }
+
+    private:
+        SolutionGenerator* generator = nullptr;
+    };
+
+    ~SolutionGenerator();
+    SolutionGenerator(SolutionGenerator&& other) noexcept;
+    SolutionGenerator& operator=(SolutionGenerator&& other) noexcept;
+
+    // searches for the next solution; false when there is none left
+    bool next();
+
+    // the last solution found by next(), valid until it is called again
+    const Assignment& value() const;
+
+    // the statistics of the search so far
+    SolveResult result() const;
+
+    iterator begin() { return ++iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+    explicit SolutionGenerator(std::unique_ptr<Impl> impl);
+
+    friend class Solver;
+};
+
+class Solver {
+public:
+    explicit Solver(SolverOptions options = {});
+    ~Solver();
+    Solver(Solver&& other) noexcept;
+    Solver& operator=(Solver&& other) noexcept;
+
+    /**
+     * searches the problem, calling on_solution with every solution until it returns false; without a callback the
+     * search stops at the first solution. The problem is left as it is and can be solved again.
+     * Like every search below, throws std::invalid_argument when a constraint uses a variable that was never added or
+     * the problem has more than one objective
+     */
+    SolveResult solve(const Problem& problem, const SolutionCallback& on_solution = {});
+
+    // the number of solutions of the problem
+    SolveResult count(const Problem& problem);
+
+    /**
+     * searches for one solution, warm started from the last one resolve() found, which is meant for solving a problem
+     * again after a few edits. When the last solution still satisfies the problem it is returned without a search;
+     * otherwise a short search that tries its values first looks for a solution close to it, before the usual search
+     */
+    SolveResult resolve(const Problem& problem, const SolutionCallback& on_solution = {});
+
+    /**
+     * searches for the solution with the best value of the objective declared with "minimize ..." or "maximize ...",
+     * calling on_improvement with every solution better than the ones before until it returns false. Throws
+     * std::invalid_argument when the problem has no objective
+     */
+    SolveResult optimize(const Problem& problem, const SolutionCallback& on_improvement = {});
+
+    // the solutions of the problem as they are asked for; the generator keeps its own copy of the problem
+    SolutionGenerator solutions(const Problem& problem);
+
+    const SolverOptions& options() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+// the version of the library, e.g. "1.0.0"
+const char* version();
+
+}
+
+#endif
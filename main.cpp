@@ -1,552 +1,723 @@
+#include "bucket_elimination.hpp"
+#include "result_cache.hpp"
+#include "solver.hpp"
+#include "tree_solver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <string>
+#include <mutex>
 #include <sstream>
-#include <fstream>
+#include <string>
+#include <thread>
 #include <unordered_map>
-#include <algorithm>
-#include <utility>
+#include <vector>
 
 
-/**
- * a hashmap to map an operator with a function to check a constraint
- */
-std::unordered_map<char, std::function<bool(int, int)>> operation_map = {
-        {'=', [](int a, int b) { return a == b; }},
-        {'!', [](int a, int b) { return a != b; }},
-        {'>', [](int a, int b) { return a > b; }},
-        {'<', [](int a, int b) { return a < b; }},
-};
+std::string json_string(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (char c: text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+
+// the consistency of a mode of the command line, "none" or "fc"
+csp::Consistency consistency_of_mode(const std::string& mode)
+{
+    return mode == "fc" ? csp::Consistency::ForwardChecking : csp::Consistency::None;
+}
 
 
 /**
- * struct to represent a constraint
+ * the options a single instance and a batch are both run with
  */
-struct Constraint {
-    char var1;
-    char var2;
-    char op;
+struct SearchOptions {
+    bool count_all = false;
+    int threads = 1;
+    long long split_threshold = 1024;
+    long long cache_mb = 0;
+    bool detect_alldiff = false;
+    bool alldiff_bounds = false;
+    double time_limit = 0.0;
 };
 
 
-class CSP {
-public:
-    // hashmap to hold assigned variables and their values. If a variable is unassigned it won't exist in this hashmap
-    std::unordered_map<char, int> assignment{};
-    // holds the domain of an instance of a CSP problem
-    std::unordered_map<char, std::vector<int>> domain;
-    // holds all the constraints of a csp. This does not change at all during any of the search states
-    std::vector<Constraint> constraints;
-    // a flag to indicate whether to do forward checking or not
-    std::string mode;
-
-    CSP(std::unordered_map<char, std::vector<int>> variables,
-        std::vector<Constraint> constraints,
-        std::string mode)
-            : domain(std::move(variables)), constraints(std::move(constraints)), mode(std::move(mode)) {}
-
-
-    bool is_complete_assignment()
+bool parse_search_option(const std::string& option, SearchOptions& options)
+{
+    /**
+     * read one of the options of SearchOptions. Returns false if the option is not one of them
+     */
+    if (option == "--count")
     {
-        /**
-         * all variables have been assigned values; solution possible
-         */
-        return assignment.size() == domain.size();
+        options.count_all = true;
     }
-
-
-    bool is_solution() {
-        /**
-         * Check if every constraint passes the current assignment of variables
-         * This function is only called whenever we have a complete assignment of variables
-         */
-
-        for (const auto& constraint: constraints)
-        {
-            if (!operation_map.at(constraint.op)(assignment.at(constraint.var1), assignment.at(constraint.var2)))
-            {
-                return false;
-            }
-
-        }
-
-        return true;
+    else if (option.rfind("--threads=", 0) == 0)
+    {
+        options.threads = std::max(1, std::stoi(option.substr(std::strlen("--threads="))));
     }
-
-
-    bool is_consistent(char variable, int value) const
+    else if (option.rfind("--split=", 0) == 0)
     {
-        /**
-         * Check that the variable and value assigned to it passes the constraint it involves.
-         * If the variable is on one side of a constraint then that constraint has to be checked
-         * against all other assigned variables.
-         */
-        for (const auto& constraint : constraints) {
-            // Check if the current variable is involved in the constraint
-            if (constraint.var1 == variable || constraint.var2 == variable) {
-                char other_var = constraint.var1 == variable ? constraint.var2 : constraint.var1;
-
-                // Check if the other variable is assigned
-                auto it = assignment.find(other_var);
-                if (it != assignment.end()) {
-                    int other_value = it->second; // Get the assigned value for the other variable
-
-                    // Perform the check based on who is var1 and who is var2 in the constraint
-                    if ((constraint.var1 == variable && !operation_map.at(constraint.op)(value, other_value)) ||
-                        (constraint.var2 == variable && !operation_map.at(constraint.op)(other_value, value))) {
-                        return false;
-                    }
-                }
-            }
-        }
-        return true;
+        options.split_threshold = std::stoll(option.substr(std::strlen("--split=")));
+    }
+    else if (option == "--cache")
+    {
+        options.cache_mb = 256;
+    }
+    else if (option.rfind("--cache=", 0) == 0)
+    {
+        options.cache_mb = std::max(1LL, std::stoll(option.substr(std::strlen("--cache="))));
+    }
+    else if (option == "--detect-alldiff")
+    {
+        options.detect_alldiff = true;
+    }
+    else if (option == "--alldiff=regin" || option == "--alldiff=bounds")
+    {
+        options.alldiff_bounds = option == "--alldiff=bounds";
+    }
+    else if (option.rfind("--time-limit=", 0) == 0)
+    {
+        options.time_limit = std::max(0.0, std::stod(option.substr(std::strlen("--time-limit="))));
     }
+    else
+    {
+        return false;
+    }
+    return true;
+}
 
 
-    std::vector<char> get_un_assigned_variables () const
+bool check_search_options(const SearchOptions& options)
+{
+    if (options.cache_mb > 0 && !options.count_all)
     {
-        /**
-        * get all the unassigned variables
-        */
-        std::vector<char> un_assigned_vars;
-        for (const auto& variable: domain)
-        {
-            // if a variable is not assigned then take it: not in assignment hashmap and its domain is not empty
-            if (assignment.find(variable.first) == assignment.end() && !domain.at(variable.first).empty())
-            {
-                un_assigned_vars.push_back(variable.first);
-            }
-        }
-        return un_assigned_vars;
+        std::cerr << "--cache only works with --count" << std::endl;
+        return false;
     }
+    return true;
+}
 
 
-    int get_domain_count (char variable) const
+int run_batch(const std::string& manifest_path, const std::vector<std::string>& options)
+{
+    /**
+     * solve many instances in one process. Every line of the manifest (or of stdin for "-") is
+     *     <path_to_var_file> <path_to_con_file> [none|fc]
+     * and the instances are solved by a pool of threads, each of them reusing its scratch arena from one instance to
+     * the next. Lines are read as the workers need them, so the manifest can be a stream. Every instance gets one
+     * JSON record on stdout when it is done, with its line number as "index"
+     */
+    std::string default_mode = "fc";
+    SearchOptions shared;
+    for (const auto& option: options)
     {
-        int domain_count = -1;
-        if (domain.find(variable) != domain.end())
+        if (parse_search_option(option, shared))
         {
-            domain_count = static_cast<int>(domain.at(variable).size());
+            continue;
+        }
+        if (option == "--mode=none" || option == "--mode=fc")
+        {
+            default_mode = option.substr(std::strlen("--mode="));
         }
         else
         {
-            std::cerr << "error - variable doesn't exist in the domain\n";
+            std::cerr << "Unknown batch option " << option << std::endl;
+            return 1;
         }
-        return domain_count;
+    }
+    if (!check_search_options(shared))
+    {
+        return 1;
     }
 
-
-    int get_constraint_count(char variable) const
+    std::ifstream manifest_file;
+    if (manifest_path != "-")
     {
-        int constraint_count = 0;
-        for (const auto& constraint: constraints)
+        manifest_file.open(manifest_path);
+        if (!manifest_file)
+        {
+            std::cerr << "error - cannot open manifest " << manifest_path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& manifest = manifest_path == "-" ? std::cin : manifest_file;
+
+    std::mutex input_mutex;
+    std::mutex output_mutex;
+    long long line_number = 0;
+    std::atomic<long long> failed{0};
+
+    auto solve_instance = [&](long long index, const std::string& line, ScratchArena& arena) {
+        std::istringstream fields(line);
+        std::string var_path, con_path, mode;
+        fields >> var_path >> con_path >> mode;
+        mode = mode.empty() ? default_mode : mode;
+
+        std::ostringstream record;
+        record << "{\"index\":" << index << ",\"var\":" << json_string(var_path) << ",\"con\":"
+               << json_string(con_path) << ",\"mode\":" << json_string(mode);
+
+        std::unordered_map<char, Domain> variables;
+        std::vector<Constraint> constraints;
+        std::vector<std::unique_ptr<Propagator>> propagators;
+        std::string error;
+        if (con_path.empty())
         {
-            if ((constraint.var1 == variable && assignment.find(constraint.var2) == assignment.end()) ||
-                    (constraint.var2 == variable && assignment.find(constraint.var1) == assignment.end()))
+            error = "expected <path_to_var_file> <path_to_con_file> [none|fc]";
+        }
+        else if (mode != "none" && mode != "fc")
+        {
+            error = "invalid mode " + mode;
+        }
+        else if (!std::ifstream(var_path) || !std::ifstream(con_path))
+        {
+            error = "cannot open " + (!std::ifstream(var_path) ? var_path : con_path);
+        }
+        else
+        {
+            // an instance is not searched when something in it cannot be read or used
+            std::vector<std::string> errors;
+            variables = get_variables_from_file(var_path, errors);
+            constraints = get_constraints_from_file(con_path, propagators, errors);
+            for (auto& problem_error: check_problem(variables, constraints, propagators))
             {
-                constraint_count += 1;
+                errors.push_back(std::move(problem_error));
             }
+            error = errors.empty() ? "" : errors.front();
         }
-        return constraint_count;
-    }
-
-
-    char select_variable() const
-    {
-
-        /**
-        * select variables based on most constrained variable and breaking ties with most constraining variable
-        * to check most constrained variable check number of available domains for a variable that is un-assigned
-        * to check most constraining variable check the number of unassigned variables that have a relationship with the variable
-        */
-
-        std::vector<char> un_assigned_variables = get_un_assigned_variables();
-        std::vector<char> most_constrained_variables;
-        for (const auto& curr_var: un_assigned_variables)
+        if (!error.empty())
         {
-            if (most_constrained_variables.empty())
+            failed++;
+            record << ",\"status\":\"error\",\"error\":" << json_string(error) << "}";
+        }
+        else
+        {
+            add_alldiff_propagators(constraints, propagators, shared.detect_alldiff, shared.alldiff_bounds);
+            bool optimize = !shared.count_all && std::any_of(propagators.begin(), propagators.end(),
+                    [](const auto& propagator) { return dynamic_cast<Objective*>(propagator.get()) != nullptr; });
+
+            CSP csp (std::move(variables), std::move(constraints), consistency_of_mode(mode), std::move(propagators),
+                     &arena);
+            csp.split_threshold = shared.split_threshold;
+            csp.count_all = shared.count_all;
+            csp.cache_limit_bytes = static_cast<size_t>(shared.cache_mb) * 1048576;
+            csp.time_limit = shared.time_limit;
+            csp.quiet = true;
+            auto solution_json = [&](const std::vector<char>& order) {
+                std::ostringstream solution;
+                solution << "{";
+                for (size_t j = 0; j < order.size(); j++)
+                {
+                    solution << (j > 0 ? "," : "") << json_string(std::string(1, order[j])) << ":"
+                             << csp.assignment.at(order[j]);
+                }
+                solution << "}";
+                return solution.str();
+            };
+
+            // a search stopped by the time limit reports "stopped" instead of "count", "optimal" or "unsat", with
+            // the count so far or the best solution so far
+            if (optimize)
             {
-                most_constrained_variables.push_back(curr_var);
+                long long best = 0;
+                std::string best_solution;
+                bool found = branch_and_bound(csp, [&](const std::vector<char>& order) {
+                    best = csp.objective->value(csp);
+                    best_solution = solution_json(order);
+                    return true;
+                });
+                if (found)
+                {
+                    record << ",\"status\":" << (csp.stopped() ? "\"stopped\"" : "\"optimal\"")
+                           << ",\"objective\":" << best << ",\"solution\":" << best_solution;
+                }
+                else
+                {
+                    record << ",\"status\":" << (csp.stopped() ? "\"stopped\"" : "\"unsat\"");
+                }
             }
             else
             {
-                int curr_var_domain_count = get_domain_count(curr_var);
-
-                char prev_selected_var = most_constrained_variables.back();
-                int prev_selected_var_count = get_domain_count(prev_selected_var);
-
-                if(curr_var_domain_count == prev_selected_var_count)
+                bool solved = backtrack_search(csp);
+                if (shared.count_all)
                 {
-                    most_constrained_variables.push_back(curr_var);
+                    record << ",\"status\":" << (csp.stopped() ? "\"stopped\"" : "\"count\"")
+                           << ",\"count\":" << static_cast<unsigned long long>(csp.stats.solutions);
                 }
-                else if (curr_var_domain_count < prev_selected_var_count)
+                else if (solved)
                 {
-                    most_constrained_variables.clear();
-                    most_constrained_variables.push_back(curr_var);
+                    record << ",\"status\":\"solution\",\"solution\":" << solution_json(csp.solution_order);
+                }
+                else
+                {
+                    record << ",\"status\":" << (csp.stopped() ? "\"stopped\"" : "\"unsat\"");
                 }
             }
+            record << ",\"nodes\":" << csp.stats.nodes << ",\"failures\":" << csp.stats.failures
+                   << ",\"time\":" << csp.stats.elapsed_seconds() << "}";
         }
 
-        if (most_constrained_variables.size() == 1)
-        {
-            return most_constrained_variables.back();
-        }
-
-        char most_constraining_variable = most_constrained_variables[0];
-        int max_constraints = get_constraint_count(most_constrained_variables[0]);
-
-        for (int i = 1; i < most_constrained_variables.size(); ++i) {
-            int curr_constraints = get_constraint_count(most_constrained_variables[i]);
-            if (curr_constraints > max_constraints) {
-                max_constraints = curr_constraints;
-                most_constraining_variable = most_constrained_variables[i];
-            }
-            else if (curr_constraints == max_constraints && most_constrained_variables[i] < most_constraining_variable) {
-                // Tie-break by lexicographical order
-                most_constraining_variable = most_constrained_variables[i];
-            }
-        }
-
-        return most_constraining_variable;
-    }
-
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << record.str() << std::endl;
+    };
 
-    std::vector<Constraint> get_constraints(char variable) const
-    {
-        std::vector<Constraint> involved_constraints;
-        for (const auto& constraint: constraints)
+    auto work = [&]() {
+        ScratchArena arena;
+        std::string line;
+        while (true)
         {
-            if ((constraint.var1 == variable && assignment.find(constraint.var2) == assignment.end()) ||
-                (constraint.var2 == variable && assignment.find(constraint.var1) == assignment.end()))
+            long long index = 0;
             {
-                involved_constraints.push_back(constraint);
+                std::lock_guard<std::mutex> lock(input_mutex);
+                bool found = false;
+                while (!found && std::getline(manifest, line))
+                {
+                    line_number++;
+                    size_t first = line.find_first_not_of(" \t\r");
+                    found = first != std::string::npos && line[first] != '#';
+                }
+                if (!found)
+                {
+                    return;
+                }
+                index = line_number;
             }
+            solve_instance(index, line, arena);
         }
-        return involved_constraints;
-    }
+    };
 
-
-    std::vector<int> select_values(char variable) const
+    std::vector<std::thread> workers;
+    for (int t = 1; t < shared.threads; t++)
     {
-        /**
-         * Given a variable check all of the values in its domain and assign a ranking based on the least constraining value
-         * if you choose a value from the domain of that variable, how many choices will remain for the rest of the unassigned variables in the variable domain
-         */
-        std::unordered_map<int, int> choices;
-        std::vector<Constraint> involved_constraints = get_constraints(variable);
-
-        for (int curr_value : domain.at(variable)) {
-            int constraint_satisfaction_count = 0;
-            for (const auto& constraint : involved_constraints) {
-                char other_var = (variable == constraint.var1) ? constraint.var2 : constraint.var1;
-                for (int other_value : domain.at(other_var)) {
-                    if ((variable == constraint.var1 && operation_map.at(constraint.op)(curr_value, other_value)) ||
-                        (variable == constraint.var2 && operation_map.at(constraint.op)(other_value, curr_value))) {
-                        constraint_satisfaction_count++;
-                    }
-                }
-            }
-            choices[curr_value] = constraint_satisfaction_count;
-        }
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker: workers)
+    {
+        worker.join();
+    }
+    return failed > 0 ? 2 : 0;
+}
 
-        std::vector<std::pair<int, int>> sortable(choices.begin(), choices.end());
-        std::sort(sortable.begin(), sortable.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-            if (a.second == b.second) {
-                return a.first < b.first;
-            }
-            return a.second > b.second;
-        });
 
-        std::vector<int> sortedValues;
-        for (const auto& pair : sortable) {
-            sortedValues.push_back(pair.first);
-        }
+int main(int argc, char *argv[]) {
 
-        return sortedValues;
+    if (argc >= 3 && std::string(argv[1]) == "--batch")
+    {
+        return run_batch(argv[2], std::vector<std::string>(argv + 3, argv + argc));
     }
 
 
-    std::unordered_map<char, std::vector<int>> forward_checking(char variable, int value) {
-        /**
-         * Given a variable and a value eliminate values from the domain of the unassigned variables that have a constraint with the chosen variable
-         * if one of the unassigned variables ends up having 0 values in it's domain then do nothing and return an empty domain
-         * if we don't reach a dead end return the old domain and update the current domain to the new restricted domain
-         */
-        std::unordered_map<char, std::vector<int>> oldDomain = domain;
-        std::unordered_map<char, std::vector<int>> newDomain = domain;
-
-        std::vector<Constraint> involved_constraints = get_constraints(variable);
-        for (const auto& constraint: involved_constraints) {
-            char other_var = (variable == constraint.var1) ? constraint.var2 : constraint.var1;
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <path_to_var_file> <path_to_con_file> <none|fc> [options]\n"
+                  << "       " << argv[0] << " --batch <manifest|-> [--threads=<n>] [--mode=<none|fc>] [--count]\n"
+                  << "             [--cache[=<MB>]] [--split=<n>] [--detect-alldiff] [--alldiff=<regin|bounds>]\n"
+                  << "             [--time-limit=<s>]\n"
+                  << "Options:\n"
+                  << "  --stats    print search statistics to stderr\n"
+                  << "  --perf     also read hardware counters for the hot regions (linux perf_event_open)\n"
+                  << "  --progress=<seconds>  print the progress and the estimated remaining time periodically\n"
+                  << "                        (the progress is also printed whenever the process receives SIGUSR1)\n"
+                  << "  --trace-json=<path>   write a chrome/perfetto trace-event timeline of the run\n"
+                  << "  --split=<n>           split domains with more than n values in two halves instead of\n"
+                  << "                        enumerating them (default 1024)\n"
+                  << "  --preprocess          simplify the constraint network before the search\n"
+                  << "  --detect-alldiff      replace cliques of '!' constraints by all-different constraints\n"
+                  << "  --alldiff=<regin|bounds>  propagate all-different with matching (default) or bounds\n"
+                  << "  --count               count all solutions instead of printing the trace\n"
+                  << "  --time-limit=<seconds>  stop the search after this long; with an objective in the constraint\n"
+                  << "                        file the best solution found so far is reported\n"
+                  << "  --components          search the connected components of the constraint graph separately\n"
+                  << "  --threads=<n>         search up to n components at the same time (default 1)\n"
+                  << "  --tree[=<n>]          solve forests of binary constraints without search, and other networks\n"
+                  << "                        through a cycle cutset of at most n variables (default 12)\n"
+                  << "  --eliminate[=<minfill|mindegree>]  solve by bucket elimination along the ordering (default\n"
+                  << "                        minfill) when its tables fit in the memory limit\n"
+                  << "  --eliminate-memory=<MB>  memory limit of bucket elimination (default 256)\n"
+                  << "  --cache[=<MB>]        with --count: split the remaining variables into components during the\n"
+                  << "                        search and cache their counts in at most MB of memory (default 256)\n"
+                  << "  --result-cache=<dir>  look the problem up in a cache of past results in dir before searching,\n"
+                  << "                        and store the result there afterwards" << std::endl;
+        return 1;
+    }
 
-            std::vector<int> other_var_new_domain;
-            for (int other_value: domain.at(other_var)) {
-                if ((variable == constraint.var1 && operation_map.at(constraint.op)(value, other_value)) ||
-                    (variable == constraint.var2 && operation_map.at(constraint.op)(other_value, value))) {
-                    other_var_new_domain.push_back(other_value);
-                }
-            }
+    std::string path_to_var_file = argv[1];
+    std::string path_to_con_file = argv[2];
+    std::string mode = argv[3];
 
-            if (other_var_new_domain.empty()) {
-                return {};
-            } else {
-                newDomain[other_var] = other_var_new_domain;
-            }
+    if (mode != "none" && mode != "fc") {
+        std::cerr << "Invalid mode. Use 'none' or 'fc'." << std::endl;
+        return 1;
+    }
+    csp::Consistency consistency = consistency_of_mode(mode);
+
+    bool print_stats = false;
+    bool use_perf = false;
+    double progress_interval = 0.0;
+    std::string trace_path;
+    SearchOptions shared;
+    bool preprocess = false;
+    bool decompose = false;
+    long long max_cutset = -1;
+    std::string elimination_order;
+    long long elimination_memory_mb = 256;
+    std::string result_cache_dir;
+    for (int arg = 4; arg < argc; arg++)
+    {
+        std::string option = argv[arg];
+        if (parse_search_option(option, shared))
+        {
+            continue;
+        }
+        if (option == "--stats")
+        {
+            print_stats = true;
+        }
+        else if (option == "--perf")
+        {
+            print_stats = true;
+            use_perf = true;
+        }
+        else if (option.rfind("--progress=", 0) == 0)
+        {
+            progress_interval = std::stod(option.substr(std::strlen("--progress=")));
+        }
+        else if (option == "--components")
+        {
+            decompose = true;
+        }
+        else if (option == "--tree")
+        {
+            max_cutset = 12;
+        }
+        else if (option.rfind("--tree=", 0) == 0)
+        {
+            max_cutset = std::max(0LL, std::stoll(option.substr(std::strlen("--tree="))));
+        }
+        else if (option == "--eliminate" || option == "--eliminate=minfill" || option == "--eliminate=mindegree")
+        {
+            elimination_order = option == "--eliminate=mindegree" ? "mindegree" : "minfill";
+        }
+        else if (option.rfind("--eliminate-memory=", 0) == 0)
+        {
+            elimination_memory_mb = std::stoll(option.substr(std::strlen("--eliminate-memory=")));
+        }
+        else if (option.rfind("--result-cache=", 0) == 0)
+        {
+            result_cache_dir = option.substr(std::strlen("--result-cache="));
+        }
+        else if (option == "--preprocess")
+        {
+            preprocess = true;
+        }
+        else if (option.rfind("--trace-json=", 0) == 0)
+        {
+            trace_path = option.substr(std::strlen("--trace-json="));
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
         }
-
-        domain = newDomain;
-        return oldDomain;
     }
 
-
-    void restore_domain(std::unordered_map<char, std::vector<int>> oldDomain)
+    if (!check_search_options(shared))
     {
-        /**
-         * restore the domain for when we backtrack for searches with forward checking
-         */
-        domain = std::move(oldDomain);
+        return 1;
     }
 
-
-    void assign_variable(char variable, int value) {
-        /**
-         * assign a variable and update the domain of that variable
-         */
-         assignment[variable] = value;
-         domain[variable].clear();
+    if (!trace_path.empty())
+    {
+        trace_recorder.start();
     }
 
-
-    void un_assign_variable(char variable) {
-        /**
-         * un-assign a variable and update the domain of that variable
-         */
-         assignment.erase(variable);
+    std::unordered_map<char, Domain> variables;
+    std::vector<Constraint> constraints;
+    std::vector<std::unique_ptr<Propagator>> propagators;
+    std::vector<std::string> errors;
+    {
+        TraceSpan span("parse variables");
+        variables = get_variables_from_file(path_to_var_file, errors);
     }
-
-
-    void print_domain ()
     {
-        /**
-         * test function to see if the input was read properly
-         */
-        for (const auto& variable: domain)
-        {
-            std::cout << variable.first<< ": ";
-            for (const auto& value: variable.second)
-            {
-                std::cout << std::to_string(value) << " ";
-            }
-            std::cout << std::endl;
-        }
+        TraceSpan span("parse constraints");
+        constraints = get_constraints_from_file(path_to_con_file, propagators, errors);
+    }
+    for (auto& problem_error: check_problem(variables, constraints, propagators))
+    {
+        errors.push_back(std::move(problem_error));
+    }
+    for (const auto& error: errors)
+    {
+        std::cerr << "error - " << error << std::endl;
     }
 
 
-    void print_constraints()
+    PreprocessResult simplified;
+    if (preprocess)
     {
-        /**
-         * test function to see if the input was read properly
-         */
-        for (const auto& constraint: constraints)
+        TraceSpan span("preprocess");
+        simplified = preprocess_network(variables, constraints, propagators);
+        if (simplified.unsatisfiable)
         {
-            std::cout << constraint.var1 << " " << constraint.op << " " << constraint.var2 << std::endl;
+            std::cerr << "preprocess: no solution, " << simplified.conflict << std::endl;
         }
     }
 
+    add_alldiff_propagators(constraints, propagators, shared.detect_alldiff, shared.alldiff_bounds);
 
-    void print_failure(const std::vector<char>& var_ordering, int i, int curr_value_fail)
+    auto configure = [&](CSP& search) {
+        for (const auto& merged: simplified.merged)
+        {
+            search.aliases[merged.second].push_back(merged.first);
+        }
+        search.progress_interval = progress_interval;
+        search.split_threshold = shared.split_threshold;
+        search.next_progress_report = progress_interval;
+        search.count_all = shared.count_all;
+        search.quiet = shared.count_all;
+        search.cache_limit_bytes = static_cast<size_t>(shared.cache_mb) * 1048576;
+        search.time_limit = shared.time_limit;
+    };
+
+    // with an objective the search looks for the best solution instead of the first one
+    bool optimize = !shared.count_all && std::any_of(propagators.begin(), propagators.end(),
+                                              [](const std::unique_ptr<Propagator>& propagator) {
+        return dynamic_cast<const Objective*>(propagator.get()) != nullptr;
+    });
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, request_progress);
+#endif
+
+    if (print_stats && preprocess)
     {
-        /**
-         * print a failure with the consistent variable ordering and the correct index of the failure branch
-         */
-         std::cout << std::to_string(i) << ". ";
-         for (int j = 0; j < var_ordering.size(); j++)
-         {
-
-             if (j == var_ordering.size()-1)
-             {
-                 std::cout << var_ordering[j] << "=" << std::to_string(curr_value_fail);
-                 std::cout << "  failure\n";
-             }
-             else
-             {
-                 std::cout << var_ordering[j] << "=" << std::to_string(assignment.at(var_ordering[j]));
-                 std::cout << ", ";
-             }
-         }
+        std::cerr << "preprocess: removed " << simplified.removed_constraints << " constraints, merged "
+                  << simplified.merged.size() << " variables" << std::endl;
     }
 
-
-    void print_success(const std::vector<char>& var_ordering, int i)
+    bool solved_without_search = false;
+    if (max_cutset >= 0)
     {
-        /**
-         * print a success with the consistent variable ordering and the correct index of the failure branch
-         */
-        std::cout << std::to_string(i) << ". ";
-        for (int j = 0; j < var_ordering.size(); j++)
+        std::string reason = "it has n-ary constraints";
+        TreeSolver tree(variables, constraints);
+        bool fits = false;
+        {
+            TraceSpan span("tree decomposition");
+            fits = propagators.empty() && tree.prepare(static_cast<size_t>(max_cutset), shared.split_threshold, reason);
+        }
+        if (fits)
         {
-            std::cout << var_ordering[j] << "=" << std::to_string(assignment.at(var_ordering[j]));
-            if (j == var_ordering.size()-1)
+            TraceSpan span("tree solve");
+            auto start = std::chrono::steady_clock::now();
+            std::unordered_map<char, int> solution;
+            if (shared.count_all)
             {
-                std::cout << "  solution\n";
+                std::cout << "solutions: " << tree.count() << std::endl;
             }
-            else
+            else if (tree.solve(solution))
             {
-                std::cout << ", ";
+                print_solution(tree.cutset_assignments, tree.order, solution, simplified.merged);
             }
+            if (print_stats)
+            {
+                std::cerr << "tree solver: cycle cutset of " << tree.cutset_size() << " variables, "
+                          << tree.cutset_assignments << " cutset assignments, "
+                          << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s"
+                          << std::endl;
+            }
+            solved_without_search = true;
+        }
+        else
+        {
+            std::cerr << "tree solver: not used, " << reason << std::endl;
         }
     }
 
-};
-
-
-
-bool recursive_backtrack_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp) {
-    // Here we check if the assignment is complete
-    if (csp.is_complete_assignment() && csp.is_solution()) {
-        // we need to print variables in order
-        i++;
-        csp.print_success(order_vars_assigned, i);
-        return true;
-    }
-
-    // select the next variable from the domain based on un-assigned variables and the current domain
-    char variable = csp.select_variable();
-    order_vars_assigned.push_back(variable);
-
-    // create value selection vector based on the least constraining value heuristic
-    std::vector<int> values_least_cnst_hstc = csp.select_values(variable);
-    for (int value : values_least_cnst_hstc) {
-        // a variable and a value was available in the domain
-        // does the new variable=value assignment pass all the constraints...?
-        if (csp.is_consistent(variable, value)) {
-
-            // ... YES it does so let's continue searching
-
-            // if we are performing forward checking then see if we reach a dead end or not
-            // the forward checking function should only update the domain if it does not lead to a dead end
-            // if it returns a non-empty oldDomain it means we can continue with our search...POGGERS
-            // if it returns an empty oldDomain we cannot continue this search ... :((
-            std::unordered_map<char, std::vector<int>> old_domain;
-
-            if (csp.mode == "fc") {
-                old_domain = csp.forward_checking(variable, value);
-                if (old_domain.empty())
-                {
-                    // ... we can't continue the search
-                    // un-assign the value from the variable and move on
-                    // the domain has remained the same
-                    continue;
-                }
+    if (!elimination_order.empty() && !solved_without_search)
+    {
+        std::string reason = "it has n-ary constraints";
+        BucketElimination buckets(variables, constraints);
+        bool fits = false;
+        {
+            TraceSpan span("elimination ordering");
+            fits = propagators.empty() &&
+                   buckets.prepare(elimination_order == "minfill", shared.split_threshold,
+                                   static_cast<long double>(elimination_memory_mb) * 1048576.0L, reason);
+        }
+        if (fits)
+        {
+            TraceSpan span("bucket elimination");
+            auto start = std::chrono::steady_clock::now();
+            std::unordered_map<char, int> solution;
+            if (shared.count_all)
+            {
+                std::cout << "solutions: " << buckets.count() << std::endl;
             }
-
-            // assign the variable=value in our current assignment
-            csp.assign_variable(variable, value);
-
-            // at this point we know for sure we can have one more branch in the search tree
-            // so increment the i
-
-            if (recursive_backtrack_search(i, order_vars_assigned, csp)) {
-                return true;
+            else if (buckets.solve(solution))
+            {
+                print_solution(1, buckets.order, solution, simplified.merged);
             }
-
-            if (csp.mode == "fc")
+            if (print_stats)
             {
-                // restore the domain first
-                csp.restore_domain(old_domain);
+                std::cerr << "bucket elimination: " << elimination_order << " ordering, induced width "
+                          << buckets.induced_width << ", largest table "
+                          << static_cast<double>(buckets.largest_table) << " entries, "
+                          << static_cast<double>(buckets.table_bytes / 1024.0L) << " kB of tables, "
+                          << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s"
+                          << std::endl;
             }
-
-            // un-assign the variable
-            csp.un_assign_variable(variable);
+            solved_without_search = true;
         }
-        else{
-            // we can print assignment here + the value that was just chosen
-            // we need to print variables in order
-            i++;
-            csp.print_failure(order_vars_assigned, i, value);
+        else
+        {
+            std::cerr << "bucket elimination: not used, " << reason << std::endl;
         }
-
     }
-    // at this point we reached a failure. We can print it
-    order_vars_assigned.pop_back();
-    return false;
-}
-
-
-void backtrack_search(CSP& csp) {
-    std::vector<char> order_vars_assigned;
-    int i = 0;
-    recursive_backtrack_search(i, order_vars_assigned, csp);
-}
-
-
-std::unordered_map<char, std::vector<int>> get_variables_from_file (const std::string& var_file_path)
-{
-    std::unordered_map<char,std::vector<int>> variables;
-    std::ifstream file(var_file_path);
-    std::string line;
 
-    while (std::getline(file, line))
+    if (decompose && optimize)
     {
-        std::istringstream input_stream(line);
-        char var, colon;
-        int value;
-        std::vector<int> domain;
-
-        input_stream >> var >> colon;
+        std::cerr << "components: not used, the problem has an objective" << std::endl;
+        decompose = false;
+    }
 
-        while (input_stream >> value)
+    std::vector<std::vector<char>> components;
+    if (decompose && !solved_without_search)
+    {
+        components = connected_components(variables, constraints, propagators);
+    }
+    if (solved_without_search)
+    {
+        // nothing left to search
+    }
+    else if (components.size() > 1)
+    {
+        if (use_perf)
         {
-            domain.push_back(value);
+            std::cerr << "hardware counters are not read when the components are searched separately" << std::endl;
         }
-
-        variables[var] = domain;
+        TraceSpan span("components");
+        solve_components(variables, constraints, propagators, components, consistency, shared.threads, configure,
+                         print_stats);
     }
-    return variables;
-}
-
-
-std::vector<Constraint> get_constraints_from_file (const std::string& const_file_path)
-{
-    std::vector<Constraint> constraints;
-
-    std::ifstream file(const_file_path);
-    std::string line;
-
-    while (std::getline(file, line))
+    else
     {
-        std::istringstream input_stream(line);
-        Constraint c{};
-        input_stream >> c.var1 >> c.op >> c.var2;
-        constraints.push_back(c);
-    }
+        CSP csp (variables, constraints, consistency, std::move(propagators));
+        configure(csp);
 
-    return constraints;
-}
+        if (optimize && !result_cache_dir.empty())
+        {
+            std::cerr << "result cache: not used, the problem has an objective" << std::endl;
+            result_cache_dir.clear();
+        }
+        ResultCache result_cache(result_cache_dir);
+        ProblemHash problem_hash;
+        bool cached = false;
+        if (!result_cache_dir.empty())
+        {
+            TraceSpan span("result cache");
+            problem_hash = canonical_hash(csp);
+            cached = use_cached_result(csp, result_cache, problem_hash);
+            if (print_stats)
+            {
+                std::cerr << "result cache: " << (cached ? "hit " : "miss ") << problem_hash.digest << std::endl;
+            }
+        }
 
+        PerfCounters perf;
+        if (use_perf)
+        {
+            std::string error;
+            if (perf.open(error))
+            {
+                csp.perf = &perf;
+            }
+            else
+            {
+                std::cerr << "hardware counters unavailable (" << error << ")" << std::endl;
+            }
+        }
 
-int main(int argc, char *argv[]) {
+        if (!cached && optimize)
+        {
+            // every solution the search finds is better than the last one; it is printed with its objective as
+            // soon as it is found, so a run that is stopped still has the best solution so far
+            long long best = 0;
+            bool found = branch_and_bound(csp, [&](const std::vector<char>&) {
+                best = csp.objective->value(csp);
+                std::cout << "objective: " << best << std::endl;
+                return true;
+            });
+            if (found)
+            {
+                std::cout << (csp.timed_out ? "best objective: " : "optimal objective: ") << best << std::endl;
+            }
+            if (csp.timed_out)
+            {
+                std::cerr << "time limit of " << shared.time_limit << " s reached" << std::endl;
+            }
+            if (print_stats)
+            {
+                csp.print_stats(std::cerr);
+            }
+        }
+        else if (!cached)
+        {
+            backtrack_search(csp);
+            if (csp.timed_out)
+            {
+                std::cerr << "time limit of " << shared.time_limit << " s reached" << std::endl;
+            }
+            if (shared.count_all)
+            {
+                // a count cut short is only a lower bound
+                std::cout << (csp.timed_out ? "solutions: at least " : "solutions: ")
+                          << static_cast<unsigned long long>(csp.stats.solutions) << std::endl;
+            }
+            // a search cut short by the time limit has no result to keep
+            if (!result_cache_dir.empty() && !csp.timed_out)
+            {
+                store_result(csp, result_cache, problem_hash);
+            }
 
-    if (argc < 4)
-    {
-        std::cerr << "Usage: " << argv[0] << " <path_to_var_file> <path_to_con_file> <none|fc>" << std::endl;
-        return 1;
+            if (print_stats)
+            {
+                csp.print_stats(std::cerr);
+            }
+        }
     }
 
-    std::string path_to_var_file = argv[1];
-    std::string path_to_con_file = argv[2];
-    std::string mode = argv[3];
-
-    if (mode != "none" && mode != "fc") {
-        std::cerr << "Invalid mode. Use 'none' or 'fc'." << std::endl;
-        return 1;
+    if (!trace_path.empty())
+    {
+        std::string error;
+        if (!trace_recorder.write(trace_path, error))
+        {
+            std::cerr << "trace: " << error << std::endl;
+        }
     }
 
-    std::unordered_map<char, std::vector<int>> variables = get_variables_from_file(path_to_var_file);
-    std::vector<Constraint> constraints = get_constraints_from_file(path_to_con_file);
-
-
-    CSP csp (variables, constraints, mode);
-    backtrack_search(csp);
-
     return 0;
 }
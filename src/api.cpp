@@ -0,0 +1,409 @@
+#include "csp/csp.hpp"
+#include "generator.hpp"
+#include "solver.hpp"
+
+namespace csp {
+
+struct Problem::Impl {
+    std::unordered_map<char, Domain> variables;
+    std::vector<Constraint> constraints;
+    // a propagator keeps search state, so every solve builds its own from these
+    std::vector<std::function<void(std::vector<std::unique_ptr<Propagator>>&)>> propagators;
+
+    // what the problem was when each open scope was pushed
+    struct Scope {
+        std::unordered_map<char, Domain> variables;
+        size_t constraints;
+        size_t propagators;
+    };
+    std::vector<Scope> scopes;
+};
+
+
+Problem::Problem() : impl(std::make_unique<Impl>()) {}
+
+Problem::~Problem() = default;
+
+Problem::Problem(const Problem& other) : impl(std::make_unique<Impl>(*other.impl)) {}
+
+Problem::Problem(Problem&& other) noexcept = default;
+
+Problem& Problem::operator=(const Problem& other)
+{
+    if (this != &other)
+    {
+        impl = std::make_unique<Impl>(*other.impl);
+    }
+    return *this;
+}
+
+Problem& Problem::operator=(Problem&& other) noexcept = default;
+
+
+void Problem::add_variable(char name, const std::vector<int>& values)
+{
+    std::vector<std::pair<int, int>> ranges;
+    ranges.reserve(values.size());
+    for (int value: values)
+    {
+        ranges.emplace_back(value, value);
+    }
+    impl->variables[name] = Domain(std::move(ranges));
+}
+
+
+void Problem::add_variable(char name, int low, int high)
+{
+    if (low > high)
+    {
+        throw std::invalid_argument(std::string("empty range for variable ") + name);
+    }
+    impl->variables[name] = Domain({{low, high}});
+}
+
+
+void Problem::add_constraint(const std::string& text)
+{
+    std::istringstream input(text);
+    std::vector<std::unique_ptr<Propagator>> propagators;
+    std::vector<std::string> errors;
+    std::vector<Constraint> constraints = parse_constraints(input, propagators, errors);
+    if (!errors.empty())
+    {
+        throw std::invalid_argument(errors.front());
+    }
+    if (constraints.empty() && propagators.empty())
+    {
+        throw std::invalid_argument("cannot read constraint '" + text + "'");
+    }
+    impl->constraints.insert(impl->constraints.end(), constraints.begin(), constraints.end());
+    if (!propagators.empty())
+    {
+        // read the text again for every solve, keeping only the propagators
+        impl->propagators.push_back([text](std::vector<std::unique_ptr<Propagator>>& out) {
+            std::istringstream input(text);
+            std::vector<std::string> errors;
+            parse_constraints(input, out, errors);
+        });
+    }
+}
+
+
+void Problem::add_table(const std::vector<char>& scope, const std::vector<std::vector<int>>& tuples)
+{
+    for (const auto& tuple: tuples)
+    {
+        if (tuple.size() != scope.size())
+        {
+            throw std::invalid_argument("a tuple does not match the table scope");
+        }
+    }
+    impl->propagators.push_back([scope, tuples](std::vector<std::unique_ptr<Propagator>>& out) {
+        out.push_back(std::make_unique<TableConstraint>(scope, tuples));
+    });
+}
+
+
+void Problem::add_all_different(const std::vector<char>& scope)
+{
+    impl->propagators.push_back([scope](std::vector<std::unique_ptr<Propagator>>& out) {
+        out.push_back(std::make_unique<AllDifferent>(scope));
+    });
+}
+
+
+void Problem::push()
+{
+    impl->scopes.push_back({impl->variables, impl->constraints.size(), impl->propagators.size()});
+}
+
+
+void Problem::pop()
+{
+    if (impl->scopes.empty())
+    {
+        throw std::logic_error("pop without a matching push");
+    }
+    Impl::Scope& scope = impl->scopes.back();
+    impl->variables = std::move(scope.variables);
+    impl->constraints.resize(scope.constraints);
+    impl->propagators.resize(scope.propagators);
+    impl->scopes.pop_back();
+}
+
+
+size_t Problem::scopes() const
+{
+    return impl->scopes.size();
+}
+
+
+Problem Problem::parse(const std::string& variables, const std::string& constraints)
+{
+    Problem problem;
+    std::istringstream variable_input(variables);
+    std::vector<std::string> errors;
+    problem.impl->variables = parse_variables(variable_input, errors);
+    if (!errors.empty())
+    {
+        throw std::invalid_argument(errors.front());
+    }
+    if (constraints.find_first_not_of(" \t\r\n") != std::string::npos)
+    {
+        problem.add_constraint(constraints);
+    }
+    return problem;
+}
+
+
+namespace {
+
+// the nodes per variable a warm started search may spend along the old solution before it starts over without it
+constexpr long long guided_nodes_per_variable = 4;
+
+SolveResult result_of(const CSP& csp)
+{
+    SolveResult result;
+    result.satisfiable = csp.stats.solutions > 0;
+    result.solutions = static_cast<unsigned long long>(csp.stats.solutions);
+    result.nodes = csp.stats.nodes;
+    result.seconds = csp.stats.elapsed_seconds();
+    result.timed_out = csp.timed_out;
+    return result;
+}
+
+}
+
+
+struct Solver::Impl {
+    SolverOptions options;
+    // every search of this solver takes its scratch memory from here, so it is only allocated once
+    ScratchArena arena;
+    // the last solution found by resolve(), and the order it was assigned in, to warm start the next one
+    std::unordered_map<char, int> last_solution;
+    std::vector<char> last_order;
+
+    // a quiet search of the problem, with its own propagators, taking its scratch memory from arena
+    std::unique_ptr<CSP> build(const Problem& problem, ScratchArena* arena) const
+    {
+        std::vector<Constraint> constraints = problem.impl->constraints;
+        std::vector<std::unique_ptr<Propagator>> propagators;
+        for (const auto& make: problem.impl->propagators)
+        {
+            make(propagators);
+        }
+        std::vector<std::string> errors = check_problem(problem.impl->variables, constraints, propagators);
+        if (!errors.empty())
+        {
+            throw std::invalid_argument(errors.front());
+        }
+        add_alldiff_propagators(constraints, propagators, options.detect_alldiff, options.alldiff_bounds);
+
+        auto csp = std::make_unique<CSP>(problem.impl->variables, std::move(constraints), options.consistency,
+                                         std::move(propagators), arena);
+        csp->split_threshold = options.split_threshold;
+        csp->time_limit = options.time_limit;
+        csp->quiet = true;
+        return csp;
+    }
+
+    template <typename Search>
+    SolveResult run(const Problem& problem, Search search)
+    {
+        std::unique_ptr<CSP> csp = build(problem, &arena);
+        search(*csp);
+        return result_of(*csp);
+    }
+};
+
+
+struct SolutionGenerator::Impl {
+    // the suspended search keeps scratch memory of its nodes here, so it cannot share the arena of the solver
+    ScratchArena arena;
+    std::unique_ptr<CSP> csp;
+    // destroyed before the CSP it searches
+    Generator<std::vector<char>> solutions;
+    Assignment current;
+};
+
+
+SolutionGenerator::SolutionGenerator(std::unique_ptr<Impl> impl) : impl(std::move(impl)) {}
+
+SolutionGenerator::~SolutionGenerator() = default;
+
+SolutionGenerator::SolutionGenerator(SolutionGenerator&& other) noexcept = default;
+
+SolutionGenerator& SolutionGenerator::operator=(SolutionGenerator&& other) noexcept = default;
+
+
+bool SolutionGenerator::next()
+{
+    impl->current.clear();
+    if (!impl->solutions.next())
+    {
+        return false;
+    }
+    for (char variable: impl->solutions.value())
+    {
+        impl->current.emplace_back(variable, impl->csp->assignment.at(variable));
+    }
+    return true;
+}
+
+
+const Assignment& SolutionGenerator::value() const
+{
+    return impl->current;
+}
+
+
+SolveResult SolutionGenerator::result() const
+{
+    return result_of(*impl->csp);
+}
+
+
+Solver::Solver(SolverOptions options) : impl(std::make_unique<Impl>())
+{
+    impl->options = options;
+}
+
+Solver::~Solver() = default;
+
+Solver::Solver(Solver&& other) noexcept = default;
+
+Solver& Solver::operator=(Solver&& other) noexcept = default;
+
+
+SolveResult Solver::solve(const Problem& problem, const SolutionCallback& on_solution)
+{
+    return impl->run(problem, [&](CSP& csp) {
+        Assignment solution;
+        if (on_solution)
+        {
+            csp.on_solution = [&](const std::vector<char>& order) {
+                solution.clear();
+                for (char variable: order)
+                {
+                    solution.emplace_back(variable, csp.assignment.at(variable));
+                }
+                return on_solution(solution);
+            };
+        }
+        backtrack_search(csp);
+    });
+}
+
+
+SolveResult Solver::count(const Problem& problem)
+{
+    return impl->run(problem, [&](CSP& csp) {
+        csp.count_all = true;
+        csp.cache_limit_bytes = impl->options.count_cache_bytes;
+        backtrack_search(csp);
+    });
+}
+
+
+SolveResult Solver::resolve(const Problem& problem, const SolutionCallback& on_solution)
+{
+    return impl->run(problem, [&](CSP& csp) {
+        csp.preferred_values = impl->last_solution;
+        std::vector<char> order = impl->last_order;
+        csp.stats.start_search();
+        if (csp.assign_preferred_values(order))
+        {
+            csp.stats.solutions = 1;
+        }
+        else
+        {
+            // a short dive along the old values first: after a small edit most of them usually still fit. When it
+            // runs out of nodes the search starts over without them
+            if (!csp.preferred_values.empty())
+            {
+                csp.node_limit = guided_nodes_per_variable * static_cast<long long>(csp.domain.size());
+            }
+            backtrack_search(csp);
+            if (csp.out_of_nodes && csp.stats.solutions == 0)
+            {
+                csp.preferred_values.clear();
+                csp.node_limit = 0;
+                csp.out_of_nodes = false;
+                backtrack_search(csp);
+            }
+            order = csp.solution_order;
+        }
+        if (csp.stats.solutions == 0)
+        {
+            return;
+        }
+
+        // the assignment of the first solution is left in the csp
+        Assignment solution;
+        impl->last_solution.clear();
+        for (char variable: order)
+        {
+            solution.emplace_back(variable, csp.assignment.at(variable));
+            impl->last_solution[variable] = csp.assignment.at(variable);
+        }
+        impl->last_order = order;
+        if (on_solution)
+        {
+            on_solution(solution);
+        }
+    });
+}
+
+
+SolveResult Solver::optimize(const Problem& problem, const SolutionCallback& on_improvement)
+{
+    long long best = 0;
+    bool stopped = false;
+    SolveResult result = impl->run(problem, [&](CSP& csp) {
+        if (csp.objective == nullptr)
+        {
+            throw std::invalid_argument("the problem has no objective");
+        }
+        Assignment solution;
+        branch_and_bound(csp, [&](const std::vector<char>& order) {
+            best = csp.objective->value(csp);
+            if (!on_improvement)
+            {
+                return true;
+            }
+            solution.clear();
+            for (char variable: order)
+            {
+                solution.emplace_back(variable, csp.assignment.at(variable));
+            }
+            stopped = !on_improvement(solution);
+            return !stopped;
+        });
+    });
+    result.objective = best;
+    result.optimal = result.satisfiable && !result.timed_out && !stopped;
+    return result;
+}
+
+
+SolutionGenerator Solver::solutions(const Problem& problem)
+{
+    auto generator = std::make_unique<SolutionGenerator::Impl>();
+    generator->csp = impl->build(problem, &generator->arena);
+    generator->solutions = generate_solutions(*generator->csp);
+    return SolutionGenerator(std::move(generator));
+}
+
+
+const SolverOptions& Solver::options() const
+{
+    return impl->options;
+}
+
+
+const char* version()
+{
+    return "1.0.0";
+}
+
+}
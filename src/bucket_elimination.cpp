@@ -0,0 +1,310 @@
+#include "bucket_elimination.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+
+bool BucketElimination::prepare(bool min_fill, long long max_domain, long double max_bytes, std::string& reason)
+{
+    /**
+     * enumerate the domains, build one relation per constrained pair and choose the elimination ordering.
+     * Returns false with a reason if the tables would not fit in max_bytes
+     */
+    for (const auto& entry: variables)
+    {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    std::vector<int> index_of(256, -1);
+    for (size_t v = 0; v < names.size(); v++)
+    {
+        index_of[static_cast<unsigned char>(names[v])] = static_cast<int>(v);
+        const Domain& domain = variables.at(names[v]);
+        if (domain.size() > max_domain)
+        {
+            reason = std::string("the domain of ") + names[v] + " is too large to enumerate";
+            return false;
+        }
+        values.emplace_back(domain.begin(), domain.end());
+    }
+
+    // the constraints of every pair, with the smaller variable first
+    std::vector<std::pair<std::pair<int, int>, std::vector<Constraint>>> pairs;
+    for (const auto& constraint: constraints)
+    {
+        int u = index_of[static_cast<unsigned char>(constraint.var1)];
+        int w = constraint.is_unary() ? u : index_of[static_cast<unsigned char>(constraint.var2)];
+        if (u < 0 || w < 0)
+        {
+            reason = "a constraint uses a variable without a domain";
+            return false;
+        }
+        if (u == w)
+        {
+            std::vector<int>& kept = values[u];
+            kept.erase(std::remove_if(kept.begin(), kept.end(), [&](int value) {
+                return !constraint.holds(value, constraint.is_unary() ? 0 : value);
+            }), kept.end());
+            continue;
+        }
+        std::pair<int, int> key(std::min(u, w), std::max(u, w));
+        auto found = std::find_if(pairs.begin(), pairs.end(), [&](const auto& pair) { return pair.first == key; });
+        if (found == pairs.end())
+        {
+            pairs.emplace_back(key, std::vector<Constraint>());
+            found = pairs.end() - 1;
+        }
+        found->second.push_back(constraint);
+    }
+
+    const size_t n = names.size();
+    std::vector<std::vector<char>> adjacent(n, std::vector<char>(n, 0));
+    for (const auto& pair: pairs)
+    {
+        adjacent[pair.first.first][pair.first.second] = adjacent[pair.first.second][pair.first.first] = 1;
+    }
+    choose_ordering(adjacent, min_fill);
+    if (table_bytes > max_bytes)
+    {
+        std::ostringstream text;
+        text << "induced width " << induced_width << " needs about " << static_cast<double>(table_bytes / 1048576.0)
+             << " MB of tables";
+        reason = text.str();
+        return false;
+    }
+
+    // the relations of the pairs go to the bucket of whichever of the two is eliminated first
+    value_index.assign(n, 0);
+    buckets.assign(n, {});
+    for (const auto& pair: pairs)
+    {
+        int u = pair.first.first;
+        int w = pair.first.second;
+        Relation relation = make_relation({u, w});
+        for (size_t entry = 0; entry < relation.table.size(); entry++)
+        {
+            int a = values[u][entry / relation.strides[0]];
+            int b = values[w][entry % relation.strides[0]];
+            bool holds = true;
+            for (const auto& constraint: pair.second)
+            {
+                bool forward = index_of[static_cast<unsigned char>(constraint.var1)] == u;
+                holds = holds && (forward ? constraint.holds(a, b) : constraint.holds(b, a));
+            }
+            relation.table[entry] = holds ? 1 : 0;
+        }
+        buckets[position[u] < position[w] ? u : w].push_back(std::move(relation));
+    }
+    return true;
+}
+
+
+bool BucketElimination::solve(std::unordered_map<char, int>& solution)
+{
+    /**
+     * eliminate with the existence of a solution in the tables, then give the variables values from the last
+     * eliminated one back to the first: some value agrees with every relation of the bucket
+     */
+    if (eliminate(true) == 0)
+    {
+        return false;
+    }
+    order.clear();
+    for (auto it = elimination.rbegin(); it != elimination.rend(); ++it)
+    {
+        int v = *it;
+        size_t chosen = values[v].size();
+        for (size_t k = 0; k < values[v].size() && chosen == values[v].size(); k++)
+        {
+            value_index[v] = k;
+            bool holds = true;
+            for (const auto& relation: buckets[v])
+            {
+                holds = holds && relation.table[relation.offset(value_index)] != 0;
+            }
+            chosen = holds ? k : chosen;
+        }
+        if (chosen == values[v].size())
+        {
+            return false;
+        }
+        value_index[v] = chosen;
+        solution[names[v]] = values[v][chosen];
+        order.push_back(names[v]);
+    }
+    return true;
+}
+
+
+unsigned long long BucketElimination::count()
+{
+    /**
+     * eliminate with the number of solutions in the tables (modulo 2^64)
+     */
+    return eliminate(false);
+}
+
+
+BucketElimination::Relation BucketElimination::make_relation(std::vector<int> scope) const
+{
+    Relation relation;
+    relation.strides.assign(scope.size(), 1);
+    size_t size = 1;
+    for (size_t i = scope.size(); i-- > 0;)
+    {
+        relation.strides[i] = size;
+        size *= values[scope[i]].size();
+    }
+    relation.scope = std::move(scope);
+    relation.table.assign(size, 0);
+    return relation;
+}
+
+
+void BucketElimination::choose_ordering(std::vector<std::vector<char>> adjacent, bool min_fill)
+{
+    /**
+     * greedy ordering: eliminate next the variable that adds the fewest edges between its neighbours (min-fill)
+     * or has the fewest neighbours (min-degree), then connect its neighbours. Records the induced width and the
+     * sizes of the tables on the way
+     */
+    const size_t n = names.size();
+    std::vector<char> eliminated(n, 0);
+    position.assign(n, 0);
+    for (size_t step = 0; step < n; step++)
+    {
+        int best = -1;
+        long long best_fill = 0;
+        long long best_degree = 0;
+        for (size_t v = 0; v < n; v++)
+        {
+            if (eliminated[v])
+            {
+                continue;
+            }
+            std::vector<size_t> around;
+            for (size_t w = 0; w < n; w++)
+            {
+                if (!eliminated[w] && adjacent[v][w])
+                {
+                    around.push_back(w);
+                }
+            }
+            long long fill = 0;
+            for (size_t i = 0; min_fill && i < around.size(); i++)
+            {
+                for (size_t j = i + 1; j < around.size(); j++)
+                {
+                    fill += adjacent[around[i]][around[j]] ? 0 : 1;
+                }
+            }
+            long long degree = static_cast<long long>(around.size());
+            if (best < 0 || fill < best_fill || (fill == best_fill && degree < best_degree))
+            {
+                best = static_cast<int>(v);
+                best_fill = fill;
+                best_degree = degree;
+            }
+        }
+
+        long double entries = 1;
+        std::vector<size_t> around;
+        for (size_t w = 0; w < n; w++)
+        {
+            if (!eliminated[w] && adjacent[best][w])
+            {
+                around.push_back(w);
+                entries *= static_cast<long double>(values[w].size());
+            }
+        }
+        for (size_t i = 0; i < around.size(); i++)
+        {
+            for (size_t j = i + 1; j < around.size(); j++)
+            {
+                adjacent[around[i]][around[j]] = adjacent[around[j]][around[i]] = 1;
+            }
+        }
+        eliminated[best] = 1;
+        position[best] = step;
+        elimination.push_back(best);
+        induced_width = std::max(induced_width, static_cast<int>(around.size()));
+        largest_table = std::max(largest_table, entries);
+        table_bytes += entries * sizeof(unsigned long long);
+    }
+}
+
+
+unsigned long long BucketElimination::eliminate(bool exists)
+{
+    /**
+     * process the buckets in elimination order. The new relation of a bucket holds, for every tuple of the other
+     * variables, the sum over the values of the eliminated one of the product of the bucket's relations (or just
+     * whether that sum is nonzero if exists). Relations without variables left multiply into the result
+     */
+    unsigned long long result = 1;
+    for (int v: elimination)
+    {
+        std::vector<int> scope;
+        for (const auto& relation: buckets[v])
+        {
+            for (int w: relation.scope)
+            {
+                if (w != v && std::find(scope.begin(), scope.end(), w) == scope.end())
+                {
+                    scope.push_back(w);
+                }
+            }
+        }
+        std::sort(scope.begin(), scope.end(), [&](int a, int b) { return position[a] < position[b]; });
+
+        Relation message = make_relation(scope);
+        std::vector<size_t> tuple(scope.size(), 0);
+        for (size_t entry = 0; entry < message.table.size(); entry++)
+        {
+            for (size_t i = 0; i < scope.size(); i++)
+            {
+                value_index[scope[i]] = tuple[i];
+            }
+            unsigned long long sum = 0;
+            for (size_t k = 0; k < values[v].size(); k++)
+            {
+                value_index[v] = k;
+                unsigned long long product = 1;
+                for (const auto& relation: buckets[v])
+                {
+                    product *= relation.table[relation.offset(value_index)];
+                    if (product == 0)
+                    {
+                        break;
+                    }
+                }
+                sum += product;
+            }
+            message.table[entry] = exists ? (sum != 0 ? 1 : 0) : sum;
+
+            // next tuple, the last variable fastest
+            for (size_t i = scope.size(); i-- > 0;)
+            {
+                if (++tuple[i] < values[scope[i]].size())
+                {
+                    break;
+                }
+                tuple[i] = 0;
+            }
+        }
+
+        if (scope.empty())
+        {
+            result *= message.table[0];
+            if (exists && result == 0)
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            buckets[scope.front()].push_back(std::move(message));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef CSP_BUCKET_ELIMINATION_HPP
+#define CSP_BUCKET_ELIMINATION_HPP
+
+#include "model.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * bucket elimination (adaptive consistency) for networks of binary constraints. The variables are eliminated one by
+ * one along a min-fill or min-degree ordering: the constraints on a variable (its bucket) are joined and the variable
+ * is projected out, which leaves a new relation on its neighbours for a later bucket. The relations are dense tables
+ * over the product of their domains, so time and memory grow with d^(w+1) for induced width w; the width is estimated
+ * before anything is built. A solution is read back by giving the variables values in the reverse order
+ */
+class BucketElimination {
+public:
+    int induced_width = 0;
+    // entries of the largest relation and bytes of all relations that the elimination builds
+    long double largest_table = 0;
+    long double table_bytes = 0;
+    // the variables in the order they get their values in a solution
+    std::vector<char> order;
+
+    BucketElimination(const std::unordered_map<char, Domain>& variables, const std::vector<Constraint>& constraints)
+            : variables(variables), constraints(constraints)
+    {
+    }
+
+
+    bool prepare(bool min_fill, long long max_domain, long double max_bytes, std::string& reason);
+
+    bool solve(std::unordered_map<char, int>& solution);
+
+    unsigned long long count();
+
+private:
+    // a dense table over the product of the domains of its scope, the last variable of the scope varying fastest
+    struct Relation {
+        std::vector<int> scope;
+        std::vector<size_t> strides;
+        std::vector<unsigned long long> table;
+
+        size_t offset(const std::vector<size_t>& value_index) const
+        {
+            size_t index = 0;
+            for (size_t i = 0; i < scope.size(); i++)
+            {
+                index += strides[i] * value_index[scope[i]];
+            }
+            return index;
+        }
+    };
+
+    const std::unordered_map<char, Domain>& variables;
+    const std::vector<Constraint>& constraints;
+    std::vector<char> names;
+    std::vector<std::vector<int>> values;
+    std::vector<int> elimination;
+    std::vector<size_t> position;
+    std::vector<std::vector<Relation>> buckets;
+    std::vector<size_t> value_index;
+
+
+    Relation make_relation(std::vector<int> scope) const;
+
+    void choose_ordering(std::vector<std::vector<char>> adjacent, bool min_fill);
+
+    unsigned long long eliminate(bool exists);
+};
+
+#endif
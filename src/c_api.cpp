@@ -0,0 +1,286 @@
+#include "csp/csp.h"
+#include "csp/csp.hpp"
+
+#include <exception>
+#include <string>
+#include <vector>
+
+/**
+ * the C interface wraps the C++ one; no exception crosses it, an error is kept for csp_last_error and reported as
+ * CSP_ERROR
+ */
+
+struct csp_problem {
+    csp::Problem problem;
+};
+
+struct csp_solutions {
+    csp::SolutionGenerator generator;
+    std::vector<char> names;
+    std::vector<int> values;
+};
+
+
+namespace {
+
+thread_local std::string last_error;
+
+template <typename Body>
+int guarded(const char* function, Body body)
+{
+    try
+    {
+        return body();
+    }
+    catch (const std::exception& e)
+    {
+        last_error = std::string(function) + ": " + e.what();
+    }
+    catch (...)
+    {
+        last_error = std::string(function) + " failed";
+    }
+    return CSP_ERROR;
+}
+
+
+csp::SolverOptions options_for(int consistency)
+{
+    csp::SolverOptions options;
+    options.consistency = consistency == CSP_CONSISTENCY_NONE ? csp::Consistency::None
+                                                              : csp::Consistency::ForwardChecking;
+    return options;
+}
+
+}
+
+
+extern "C" {
+
+csp_problem* csp_problem_create(void)
+{
+    try
+    {
+        return new csp_problem();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+
+void csp_problem_destroy(csp_problem* problem)
+{
+    delete problem;
+}
+
+
+int csp_add_variable(csp_problem* problem, char name, const int* values, size_t count)
+{
+    return guarded("csp_add_variable", [&] {
+        if (problem == nullptr || (values == nullptr && count > 0))
+        {
+            return CSP_ERROR;
+        }
+        problem->problem.add_variable(name, std::vector<int>(values, values + count));
+        return CSP_OK;
+    });
+}
+
+
+int csp_add_variable_range(csp_problem* problem, char name, int low, int high)
+{
+    return guarded("csp_add_variable_range", [&] {
+        if (problem == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        problem->problem.add_variable(name, low, high);
+        return CSP_OK;
+    });
+}
+
+
+int csp_add_constraint(csp_problem* problem, const char* text)
+{
+    return guarded("csp_add_constraint", [&] {
+        if (problem == nullptr || text == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        problem->problem.add_constraint(text);
+        return CSP_OK;
+    });
+}
+
+
+int csp_add_table(csp_problem* problem, const char* scope, size_t arity, const int* tuples, size_t tuple_count)
+{
+    return guarded("csp_add_table", [&] {
+        if (problem == nullptr || scope == nullptr || (tuples == nullptr && arity * tuple_count > 0))
+        {
+            return CSP_ERROR;
+        }
+        std::vector<std::vector<int>> rows;
+        rows.reserve(tuple_count);
+        for (size_t t = 0; t < tuple_count; t++)
+        {
+            rows.emplace_back(tuples + t * arity, tuples + (t + 1) * arity);
+        }
+        problem->problem.add_table(std::vector<char>(scope, scope + arity), rows);
+        return CSP_OK;
+    });
+}
+
+
+int csp_add_all_different(csp_problem* problem, const char* scope)
+{
+    return guarded("csp_add_all_different", [&] {
+        if (problem == nullptr || scope == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        std::string names(scope);
+        problem->problem.add_all_different(std::vector<char>(names.begin(), names.end()));
+        return CSP_OK;
+    });
+}
+
+
+int csp_push(csp_problem* problem)
+{
+    return guarded("csp_push", [&] {
+        if (problem == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        problem->problem.push();
+        return CSP_OK;
+    });
+}
+
+
+int csp_pop(csp_problem* problem)
+{
+    return guarded("csp_pop", [&] {
+        if (problem == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        problem->problem.pop();
+        return CSP_OK;
+    });
+}
+
+
+int csp_solve(const csp_problem* problem, int consistency, csp_solution_callback on_solution, void* user)
+{
+    return guarded("csp_solve", [&] {
+        if (problem == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        csp::Solver solver(options_for(consistency));
+        csp::SolutionCallback callback;
+        if (on_solution != nullptr)
+        {
+            std::vector<char> names;
+            std::vector<int> values;
+            callback = [=](const csp::Assignment& solution) mutable {
+                names.clear();
+                values.clear();
+                for (const auto& variable: solution)
+                {
+                    names.push_back(variable.first);
+                    values.push_back(variable.second);
+                }
+                return on_solution(names.data(), values.data(), solution.size(), user) != 0;
+            };
+        }
+        return solver.solve(problem->problem, callback).satisfiable ? 1 : 0;
+    });
+}
+
+
+int csp_count(const csp_problem* problem, int consistency, unsigned long long* count)
+{
+    return guarded("csp_count", [&] {
+        if (problem == nullptr || count == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        csp::Solver solver(options_for(consistency));
+        *count = solver.count(problem->problem).solutions;
+        return CSP_OK;
+    });
+}
+
+
+csp_solutions* csp_solutions_create(const csp_problem* problem, int consistency)
+{
+    if (problem == nullptr)
+    {
+        return nullptr;
+    }
+    try
+    {
+        csp::Solver solver(options_for(consistency));
+        return new csp_solutions{solver.solutions(problem->problem), {}, {}};
+    }
+    catch (const std::exception& e)
+    {
+        last_error = std::string("csp_solutions_create: ") + e.what();
+    }
+    catch (...)
+    {
+        last_error = "csp_solutions_create failed";
+    }
+    return nullptr;
+}
+
+
+int csp_solutions_next(csp_solutions* solutions, const char** names, const int** values, size_t* count)
+{
+    return guarded("csp_solutions_next", [&] {
+        if (solutions == nullptr || names == nullptr || values == nullptr || count == nullptr)
+        {
+            return CSP_ERROR;
+        }
+        if (!solutions->generator.next())
+        {
+            return 0;
+        }
+        solutions->names.clear();
+        solutions->values.clear();
+        for (const auto& variable: solutions->generator.value())
+        {
+            solutions->names.push_back(variable.first);
+            solutions->values.push_back(variable.second);
+        }
+        *names = solutions->names.data();
+        *values = solutions->values.data();
+        *count = solutions->names.size();
+        return 1;
+    });
+}
+
+
+void csp_solutions_destroy(csp_solutions* solutions)
+{
+    delete solutions;
+}
+
+
+const char* csp_last_error(void)
+{
+    return last_error.c_str();
+}
+
+
+const char* csp_version(void)
+{
+    return csp::version();
+}
+
+}
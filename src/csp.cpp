@@ -0,0 +1,621 @@
+#include "solver.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+
+CSP::CSP(std::shared_ptr<const Model> problem, csp::Consistency consistency, ScratchArena* shared_arena)
+        : arena(shared_arena != nullptr ? *shared_arena : own_arena), model(std::move(problem)),
+          domain(model->domain), constraints(model->constraints), constraints_of(model->constraints_of),
+          propagators(model->propagators), propagators_of(model->propagators_of), objective(model->objective),
+          propagator_state(model->propagator_state), consistency(consistency)
+{
+}
+
+
+CSP::CSP(std::unordered_map<char, Domain> variables,
+         const std::vector<Constraint>& constraints,
+         csp::Consistency consistency,
+         std::vector<std::unique_ptr<Propagator>> n_ary_constraints,
+         ScratchArena* shared_arena)
+        : CSP(build_model(std::move(variables), constraints, std::move(n_ary_constraints)), consistency,
+              shared_arena)
+{
+}
+
+
+std::pmr::vector<char> CSP::get_un_assigned_variables() const
+{
+    /**
+    * get all the unassigned variables. The vector lives in the arena frame of the caller
+    */
+    std::pmr::vector<char> un_assigned_vars(&arena);
+    un_assigned_vars.reserve(domain.size());
+    for (const auto& variable: domain)
+    {
+        // if a variable is not assigned then take it: not in assignment hashmap and its domain is not empty
+        if (assignment.find(variable.first) == assignment.end() && !domain.at(variable.first).empty())
+        {
+            un_assigned_vars.push_back(variable.first);
+        }
+    }
+    return un_assigned_vars;
+}
+
+
+int CSP::get_constraint_count(char variable) const
+{
+    int constraint_count = 0;
+    for (size_t index: constraints_of_variable(variable))
+    {
+        const Constraint& constraint = constraints[index];
+        if ((constraint.var1 == variable && assignment.find(constraint.var2) == assignment.end()) ||
+                (constraint.var2 == variable && assignment.find(constraint.var1) == assignment.end()))
+        {
+            constraint_count += 1;
+        }
+    }
+
+    // an n-ary constraint counts once as long as it still has another unassigned variable
+    auto involved = propagators_of.find(variable);
+    if (involved != propagators_of.end())
+    {
+        for (size_t index: involved->second)
+        {
+            for (char other_var: propagators[index]->scope)
+            {
+                if (other_var != variable && assignment.find(other_var) == assignment.end())
+                {
+                    constraint_count += 1;
+                    break;
+                }
+            }
+        }
+    }
+    return constraint_count;
+}
+
+
+char CSP::select_variable() const
+{
+
+    /**
+    * select variables based on most constrained variable and breaking ties with most constraining variable
+    * to check most constrained variable check number of available domains for a variable that is un-assigned
+    * to check most constraining variable check the number of unassigned variables that have a relationship with the variable
+    */
+    PerfRegion region(perf, Region::SelectVariable);
+    ArenaFrame frame(arena);
+
+    std::pmr::vector<char> un_assigned_variables = get_un_assigned_variables();
+    if (un_assigned_variables.empty())
+    {
+        // every variable left has an empty domain
+        return 0;
+    }
+    std::pmr::vector<char> most_constrained_variables(&arena);
+    most_constrained_variables.reserve(un_assigned_variables.size());
+    for (const auto& curr_var: un_assigned_variables)
+    {
+        if (most_constrained_variables.empty())
+        {
+            most_constrained_variables.push_back(curr_var);
+        }
+        else
+        {
+            long long curr_var_domain_count = get_domain_count(curr_var);
+
+            char prev_selected_var = most_constrained_variables.back();
+            long long prev_selected_var_count = get_domain_count(prev_selected_var);
+
+            if(curr_var_domain_count == prev_selected_var_count)
+            {
+                most_constrained_variables.push_back(curr_var);
+            }
+            else if (curr_var_domain_count < prev_selected_var_count)
+            {
+                most_constrained_variables.clear();
+                most_constrained_variables.push_back(curr_var);
+            }
+        }
+    }
+
+    if (most_constrained_variables.size() == 1)
+    {
+        return most_constrained_variables.back();
+    }
+
+    char most_constraining_variable = most_constrained_variables[0];
+    int max_constraints = get_constraint_count(most_constrained_variables[0]);
+
+    for (int i = 1; i < most_constrained_variables.size(); ++i) {
+        int curr_constraints = get_constraint_count(most_constrained_variables[i]);
+        if (curr_constraints > max_constraints) {
+            max_constraints = curr_constraints;
+            most_constraining_variable = most_constrained_variables[i];
+        }
+        else if (curr_constraints == max_constraints && most_constrained_variables[i] < most_constraining_variable) {
+            // Tie-break by lexicographical order
+            most_constraining_variable = most_constrained_variables[i];
+        }
+    }
+
+    return most_constraining_variable;
+}
+
+
+std::pmr::vector<Constraint> CSP::get_constraints(char variable) const
+{
+    /**
+     * constraints between the variable and an unassigned variable. The vector lives in the arena frame of the caller
+     */
+    std::pmr::vector<Constraint> involved_constraints(&arena);
+    for (size_t index: constraints_of_variable(variable))
+    {
+        const Constraint& constraint = constraints[index];
+        if ((constraint.var1 == variable && assignment.find(constraint.var2) == assignment.end()) ||
+            (constraint.var2 == variable && assignment.find(constraint.var1) == assignment.end()))
+        {
+            involved_constraints.push_back(constraint);
+        }
+    }
+    return involved_constraints;
+}
+
+
+std::pmr::vector<int> CSP::select_values(char variable) const
+{
+    /**
+     * Given a variable check all of the values in its domain and assign a ranking based on the least constraining value
+     * if you choose a value from the domain of that variable, how many choices will remain for the rest of the unassigned variables in the variable domain
+     * The returned vector lives in the arena frame of the caller
+     */
+    PerfRegion region(perf, Region::SelectValues);
+    const Domain& values = domain.at(variable);
+    std::pmr::vector<int> sortedValues(&arena);
+    sortedValues.reserve(static_cast<size_t>(values.size()));
+
+    // everything below is only needed to rank the values, so it is given back before returning
+    ArenaFrame frame(arena);
+    std::pmr::vector<Constraint> involved_constraints = get_constraints(variable);
+    std::pmr::vector<std::pair<int, long long>> sortable(&arena);
+    sortable.reserve(static_cast<size_t>(values.size()));
+
+    for (int curr_value : values) {
+        long long constraint_satisfaction_count = 0;
+        for (const auto& constraint : involved_constraints) {
+            // count the values of the other variable that stay possible. They are a range, or everything but one
+            // value for '!', which the sorted domain answers with binary searches
+            bool from_var1 = variable == constraint.var1;
+            const Domain& other_domain = domain.at(from_var1 ? constraint.var2 : constraint.var1);
+            if (constraint.op == '!') {
+                long long excluded = 0;
+                bool excludes = constraint.excluded_value(from_var1, curr_value, excluded);
+                constraint_satisfaction_count += other_domain.size() -
+                        (excludes && excluded >= INT_MIN && excluded <= INT_MAX && other_domain.contains(static_cast<int>(excluded)) ? 1 : 0);
+            }
+            else {
+                std::pair<long long, long long> kept = constraint.supports(from_var1, curr_value, curr_value);
+                constraint_satisfaction_count += other_domain.count_range(kept.first, kept.second);
+            }
+        }
+        sortable.emplace_back(curr_value, constraint_satisfaction_count);
+    }
+
+    std::sort(sortable.begin(), sortable.end(), [](const std::pair<int, long long>& a, const std::pair<int, long long>& b) {
+        if (a.second == b.second) {
+            return a.first < b.first;
+        }
+        return a.second > b.second;
+    });
+
+    for (const auto& pair : sortable) {
+        sortedValues.push_back(pair.first);
+    }
+
+    return sortedValues;
+}
+
+
+bool CSP::forward_checking(char variable, int value)
+{
+    /**
+     * Given a variable and a value eliminate values from the domain of the unassigned variables that have a constraint with the chosen variable
+     * every domain is saved on the trail before it is changed so restore_domain can bring it back when we backtrack
+     * if one of the unassigned variables ends up having 0 values in it's domain then undo the changes and return false
+     */
+    PerfRegion region(perf, Region::ForwardChecking);
+    TraceSpan span("forward_checking");
+    ArenaFrame frame(arena);
+    TrailMark mark = trail_mark();
+    long long removed = 0;
+
+    std::pmr::vector<Constraint> involved_constraints = get_constraints(variable);
+    for (const auto& constraint: involved_constraints) {
+        bool from_var1 = variable == constraint.var1;
+        char other_var = from_var1 ? constraint.var2 : constraint.var1;
+        Domain& other_domain = domain.at(other_var);
+        long long before = other_domain.size();
+
+        if (other_domain.empty()) {
+            // a variable that was given no values at all can never be satisfied
+            restore_domain(mark);
+            span.set_arg("values removed", removed);
+            return false;
+        }
+
+        if (constraint.op == '!') {
+            // '!' rules out at most one value
+            long long excluded = 0;
+            if (!constraint.excluded_value(from_var1, value, excluded) || excluded < INT_MIN || excluded > INT_MAX ||
+                !other_domain.contains(static_cast<int>(excluded))) {
+                continue;
+            }
+            save_domain(other_var);
+            other_domain.remove(static_cast<int>(excluded));
+        }
+        else {
+            // the surviving values are one contiguous range: a bound check on the smallest and largest value tells
+            // if anything has to go, and the domain is then cut on both sides
+            std::pair<long long, long long> kept = constraint.supports(from_var1, value, value);
+            if (!narrow_domain(other_var, kept.first, kept.second)) {
+                continue;
+            }
+        }
+        removed += before - other_domain.size();
+
+        if (other_domain.empty()) {
+            restore_domain(mark);
+            span.set_arg("values removed", removed);
+            return false;
+        }
+    }
+
+    span.set_arg("values removed", removed);
+    return true;
+}
+
+
+bool CSP::propagate_constraints(char changed_variable, size_t changed_from)
+{
+    /**
+     * run the n-ary constraints on the changed variable and on the variables whose domain was saved on the trail
+     * after changed_from, until none of them removes anything more. Returns false on a wipeout
+     */
+    if (propagators.empty())
+    {
+        return true;
+    }
+    TraceSpan span("propagate");
+    ArenaFrame frame(arena);
+    std::pmr::vector<char> pending(propagators.size(), 0, &arena);
+
+    auto schedule = [&](char variable, size_t except) {
+        auto involved = propagators_of.find(variable);
+        if (involved != propagators_of.end())
+        {
+            for (size_t index: involved->second)
+            {
+                propagators[index]->notify(*this, variable);
+                pending[index] = index != except ? 1 : pending[index];
+            }
+        }
+    };
+
+    schedule(changed_variable, propagators.size());
+    for (size_t entry = changed_from; entry < trail.size(); entry++)
+    {
+        schedule(trail[entry].variable, propagators.size());
+    }
+
+    for (size_t index = 0; index < propagators.size();)
+    {
+        if (!pending[index])
+        {
+            index++;
+            continue;
+        }
+        pending[index] = 0;
+
+        size_t before = trail.size();
+        if (!propagators[index]->propagate(*this))
+        {
+            return false;
+        }
+        for (size_t entry = before; entry < trail.size(); entry++)
+        {
+            schedule(trail[entry].variable, index);
+        }
+        // start over: a changed variable may have woken up a propagator that was already passed
+        index = trail.size() > before ? 0 : index + 1;
+    }
+    return true;
+}
+
+
+bool CSP::propagate_bounds(char changed_variable)
+{
+    /**
+     * bounds consistency: starting from a variable whose domain changed, narrow the smallest and largest value of
+     * the unassigned neighbours until each of them has a support in the bounds of the other side of every
+     * constraint. An assigned variable counts as the single value it was given. Returns false if a domain runs empty
+     */
+    ArenaFrame frame(arena);
+    std::pmr::vector<char> queue(&arena);
+    queue.push_back(changed_variable);
+
+    while (!queue.empty())
+    {
+        char variable = queue.back();
+        queue.pop_back();
+
+        auto assigned = assignment.find(variable);
+        long long lo = assigned != assignment.end() ? assigned->second : get_domain_min(variable);
+        long long hi = assigned != assignment.end() ? assigned->second : get_domain_max(variable);
+
+        for (size_t index: constraints_of_variable(variable))
+        {
+            const Constraint& constraint = constraints[index];
+            char other_var = (variable == constraint.var1) ? constraint.var2 : constraint.var1;
+            if (other_var == variable || assignment.find(other_var) != assignment.end())
+            {
+                continue;
+            }
+
+            // the other variable needs a support among the values of variable in [lo, hi]
+            bool from_var1 = variable == constraint.var1;
+            bool changed = false;
+            if (constraint.op != '!')
+            {
+                std::pair<long long, long long> kept = constraint.supports(from_var1, lo, hi);
+                changed = narrow_domain(other_var, kept.first, kept.second);
+            }
+            else
+            {
+                long long excluded = 0;
+                if (lo == hi && constraint.excluded_value(from_var1, lo, excluded) && excluded >= INT_MIN &&
+                    excluded <= INT_MAX && domain.at(other_var).contains(static_cast<int>(excluded)))
+                {
+                    save_domain(other_var);
+                    changed = domain.at(other_var).remove(static_cast<int>(excluded));
+                }
+            }
+
+            if (changed)
+            {
+                if (domain.at(other_var).empty())
+                {
+                    return false;
+                }
+                queue.push_back(other_var);
+            }
+        }
+    }
+    return true;
+}
+
+
+void CSP::print_domain()
+{
+    /**
+     * test function to see if the input was read properly
+     */
+    for (const auto& variable: domain)
+    {
+        std::cout << variable.first<< ": ";
+        for (const auto& interval: variable.second.get_intervals())
+        {
+            if (interval.lo == interval.hi)
+            {
+                std::cout << std::to_string(interval.lo) << " ";
+            }
+            else
+            {
+                std::cout << std::to_string(interval.lo) << ".." << std::to_string(interval.hi) << " ";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+
+void CSP::print_constraints()
+{
+    /**
+     * test function to see if the input was read properly
+     */
+    for (const auto& constraint: constraints)
+    {
+        std::cout << constraint.var1 << " " << operator_symbol(constraint.op) << " ";
+        if (!constraint.is_unary())
+        {
+            if (constraint.coef != 1)
+            {
+                std::cout << constraint.coef << "*";
+            }
+            std::cout << constraint.var2;
+            if (constraint.offset != 0)
+            {
+                std::cout << (constraint.offset > 0 ? " + " : " - ") << std::abs(constraint.offset);
+            }
+        }
+        else
+        {
+            std::cout << constraint.offset;
+        }
+        std::cout << std::endl;
+    }
+    for (const auto& propagator: propagators)
+    {
+        std::cout << propagator->describe() << std::endl;
+    }
+}
+
+
+void CSP::print_stats(std::ostream& out) const
+{
+    /**
+     * print the counters of the search, followed by the hardware counters when they were collected
+     */
+    out << "search statistics:\n";
+    out << "  nodes: " << stats.nodes << "\n";
+    out << "  consistency checks: " << stats.consistency_checks << "\n";
+    out << "  failures: " << stats.failures << "\n";
+    out << "  forward checking wipeouts: " << stats.fc_wipeouts << "\n";
+    out << "  backtracks: " << stats.backtracks << "\n";
+    out << "  solutions: " << stats.solutions << "\n";
+    out << "  time: " << stats.elapsed_seconds() << " s\n";
+    if (stats.cache_hits + stats.cache_misses > 0)
+    {
+        out << "  component cache hits: " << stats.cache_hits << "\n";
+        out << "  component cache misses: " << stats.cache_misses << "\n";
+        out << "  component cache evictions: " << stats.cache_evictions << "\n";
+    }
+#ifdef CSP_ALLOC_PROFILE
+    long long allocations = alloc_profile::allocations.load() - stats.allocations_at_start;
+    long long bytes = alloc_profile::bytes_allocated.load() - stats.bytes_at_start;
+    out << "  heap allocations: " << allocations << "\n";
+    out << "  heap allocations per node: "
+        << (stats.nodes > 0 ? static_cast<double>(allocations) / static_cast<double>(stats.nodes) : 0.0) << "\n";
+    out << "  heap bytes allocated: " << bytes << "\n";
+    out << "  peak live heap bytes: " << alloc_profile::peak_live_bytes.load() << "\n";
+#endif
+    long long peak_rss = get_peak_rss_kb();
+    if (peak_rss >= 0)
+    {
+        out << "  peak rss: " << peak_rss << " kB\n";
+    }
+    if (perf != nullptr && perf->is_enabled())
+    {
+        perf->print(out);
+    }
+}
+
+
+long long CSP::get_unassigned_domain_size() const
+{
+    /**
+     * total number of values left in the domains of the unassigned variables
+     */
+    long long total = 0;
+    for (const auto& variable: domain)
+    {
+        if (assignment.find(variable.first) == assignment.end())
+        {
+            total += static_cast<long long>(variable.second.size());
+        }
+    }
+    return total;
+}
+
+
+void CSP::print_progress(std::ostream& out, int depth) const
+{
+    /**
+     * print the counters, the depth profile and the estimated size and remaining time of the running search
+     */
+    double elapsed = stats.elapsed_seconds();
+    double estimate = tree_estimate.estimate();
+    long long visited = tree_estimate.visited_nodes();
+
+    out << "progress after " << elapsed << " s at depth " << depth << ":\n";
+    print_stats(out);
+    out << "  depth profile (depth: nodes failures):\n";
+    for (size_t d = 0; d < stats.nodes_per_depth.size(); d++)
+    {
+        out << "    " << d << ": " << stats.nodes_per_depth[d] << " " << stats.failures_per_depth[d] << "\n";
+    }
+    out << "  tree nodes visited: " << visited << "\n";
+    out << "  estimated tree size: " << estimate << "\n";
+    if (visited > 0 && estimate > static_cast<double>(visited))
+    {
+        out << "  estimated time remaining: " << elapsed * (estimate - visited) / visited << " s\n";
+    }
+    out << std::flush;
+}
+
+
+bool CSP::assign_preferred_values(std::vector<char>& order)
+{
+    /**
+     * assign every variable its preferred value, in the order of the variables, and check that this is a solution.
+     * When it is not, nothing is left assigned. A warm start whose old solution still holds needs no search
+     */
+    if (model->infeasible || preferred_values.size() < domain.size() || !assignment.empty())
+    {
+        return false;
+    }
+    for (char variable: order)
+    {
+        auto hint = preferred_values.find(variable);
+        auto values = domain.find(variable);
+        if (hint == preferred_values.end() || values == domain.end() || !values->second.contains(hint->second) ||
+            !is_consistent(variable, hint->second))
+        {
+            break;
+        }
+        assign_variable(variable, hint->second);
+    }
+    if (is_complete_assignment() && is_solution())
+    {
+        return true;
+    }
+    assignment.clear();
+    return false;
+}
+
+
+void CSP::print_failure(const std::vector<char>& var_ordering, int i, int curr_value_fail)
+{
+    /**
+     * print a failure with the consistent variable ordering and the correct index of the failure branch
+     */
+     std::cout << std::to_string(i) << ". ";
+     for (int j = 0; j < var_ordering.size(); j++)
+     {
+
+         if (j == var_ordering.size()-1)
+         {
+             std::cout << var_ordering[j] << "=" << std::to_string(curr_value_fail);
+             std::cout << "  failure\n";
+         }
+         else
+         {
+             std::cout << var_ordering[j] << "=" << std::to_string(assignment.at(var_ordering[j]));
+             std::cout << ", ";
+         }
+     }
+}
+
+
+void CSP::print_success(const std::vector<char>& var_ordering, int i)
+{
+    /**
+     * print a success with the consistent variable ordering and the correct index of the failure branch
+     */
+    std::cout << std::to_string(i) << ". ";
+    print_assignment(std::cout, var_ordering);
+    std::cout << "  solution\n";
+}
+
+
+void CSP::print_assignment(std::ostream& out, const std::vector<char>& var_ordering) const
+{
+    /**
+     * print "A=1, B=2" for the variables in order, each followed by the variables merged into it
+     */
+    for (size_t j = 0; j < var_ordering.size(); j++)
+    {
+        out << (j > 0 ? ", " : "") << var_ordering[j] << "=" << std::to_string(assignment.at(var_ordering[j]));
+        auto merged = aliases.find(var_ordering[j]);
+        if (merged != aliases.end())
+        {
+            for (char alias: merged->second)
+            {
+                out << ", " << alias << "=" << std::to_string(assignment.at(var_ordering[j]));
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef CSP_GENERATOR_HPP
+#define CSP_GENERATOR_HPP
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+
+/**
+ * a lazily computed sequence of values: each next() resumes the coroutine until its next co_yield. The value is only
+ * valid until the following next(), since it usually lives in the suspended coroutine
+ */
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object()
+        {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(const T& value) noexcept
+        {
+            current = &value;
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+    };
+
+    Generator() = default;
+
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Generator& operator=(Generator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    ~Generator()
+    {
+        reset();
+    }
+
+    // false once the coroutine has returned
+    bool next()
+    {
+        if (!handle || handle.done())
+        {
+            return false;
+        }
+        handle.resume();
+        if (handle.promise().error)
+        {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+        return !handle.done();
+    }
+
+    const T& value() const
+    {
+        return *handle.promise().current;
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    void reset()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,301 @@
+#include "instrumentation.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef CSP_ALLOC_PROFILE
+/**
+ * counting replacements of the global allocation functions, compiled in with the CSP_ALLOC_PROFILE build option.
+ * Every block carries a small header with its size so the live and peak heap size can be tracked on any delete
+ */
+namespace alloc_profile {
+    std::atomic<long long> allocations{0};
+    std::atomic<long long> deallocations{0};
+    std::atomic<long long> bytes_allocated{0};
+    std::atomic<long long> live_bytes{0};
+    std::atomic<long long> peak_live_bytes{0};
+
+    constexpr std::size_t header_size = alignof(std::max_align_t);
+
+    void* allocate(std::size_t size, std::size_t alignment)
+    {
+        std::size_t header = alignment > header_size ? alignment : header_size;
+        std::size_t total = (header + size + alignment - 1) / alignment * alignment;
+        void* block = alignment > header_size ? std::aligned_alloc(alignment, total) : std::malloc(total);
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        auto* bytes = static_cast<unsigned char*>(block);
+        auto* user = bytes + header;
+        // the size and the header length sit right in front of the pointer handed out
+        reinterpret_cast<std::size_t*>(user)[-1] = size;
+        reinterpret_cast<std::size_t*>(user)[-2] = header;
+
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes_allocated.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+        long long live = live_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed) +
+                static_cast<long long>(size);
+        long long peak = peak_live_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        return user;
+    }
+
+    void deallocate(void* pointer)
+    {
+        if (pointer == nullptr)
+        {
+            return;
+        }
+        auto* user = static_cast<unsigned char*>(pointer);
+        std::size_t size = reinterpret_cast<std::size_t*>(user)[-1];
+        std::size_t header = reinterpret_cast<std::size_t*>(user)[-2];
+
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+        live_bytes.fetch_sub(static_cast<long long>(size), std::memory_order_relaxed);
+        std::free(user - header);
+    }
+}
+
+void* operator new(std::size_t size) { return alloc_profile::allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return alloc_profile::allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return alloc_profile::allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return alloc_profile::allocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* pointer) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { alloc_profile::deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { alloc_profile::deallocate(pointer); }
+#endif
+
+
+long long get_peak_rss_kb()
+{
+    /**
+     * peak resident set size of the process in kilobytes, or -1 when the platform does not report it
+     */
+#ifdef __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return usage.ru_maxrss;
+    }
+#endif
+    return -1;
+}
+
+
+/**
+ * set asynchronously by the SIGUSR1 handler; the search polls it and prints its progress without stopping
+ */
+volatile std::sig_atomic_t progress_requested = 0;
+
+extern "C" void request_progress(int)
+{
+    progress_requested = 1;
+}
+
+
+/**
+ * the process wide trace; it records nothing unless the solver was started with --trace-json
+ */
+TraceRecorder trace_recorder;
+
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+
+bool PerfCounters::open(std::string& error)
+{
+    /**
+     * open the counter group for the calling thread. On failure (no kernel support, perf_event_paranoid, ...)
+     * the reason is stored in error and the solver keeps running without hardware counters
+     */
+#ifdef __linux__
+    const uint64_t configs[event_count] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (int e = 0; e < event_count; e++)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        attr.disabled = e == 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        int group_fd = e == 0 ? -1 : fds[0];
+        fds[e] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+        if (fds[e] == -1)
+        {
+            error = std::string("perf_event_open: ") + std::strerror(errno);
+            return false;
+        }
+    }
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    enabled = true;
+    return true;
+#else
+    error = "hardware counters are only supported on linux";
+    return false;
+#endif
+}
+
+
+void PerfCounters::read_counters(uint64_t values[event_count]) const
+{
+    /**
+     * read the whole group at once: the kernel returns the number of events followed by one value per event
+     */
+#ifdef __linux__
+    uint64_t buffer[1 + event_count] = {};
+    if (read(fds[0], buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer)))
+    {
+        std::memcpy(values, buffer + 1, sizeof(uint64_t) * event_count);
+        return;
+    }
+#endif
+    std::memset(values, 0, sizeof(uint64_t) * event_count);
+}
+
+
+void PerfCounters::print(std::ostream& out) const
+{
+    out << "hardware counters per region:\n";
+    out << std::left << std::setw(18) << "  region" << std::right
+        << std::setw(12) << "calls" << std::setw(16) << "cycles" << std::setw(16) << "instructions"
+        << std::setw(8) << "IPC" << std::setw(14) << "cache-misses" << std::setw(15) << "branch-misses"
+        << std::setw(14) << "cycles/call" << "\n";
+    for (int r = 0; r < region_count; r++)
+    {
+        double ipc = totals[r][0] ? static_cast<double>(totals[r][1]) / static_cast<double>(totals[r][0]) : 0.0;
+        double per_call = calls[r] ? static_cast<double>(totals[r][0]) / static_cast<double>(calls[r]) : 0.0;
+        out << "  " << std::left << std::setw(16) << region_name(static_cast<Region>(r)) << std::right
+            << std::setw(12) << calls[r] << std::setw(16) << totals[r][0] << std::setw(16) << totals[r][1]
+            << std::setw(8) << std::fixed << std::setprecision(2) << ipc
+            << std::setw(14) << totals[r][2] << std::setw(15) << totals[r][3]
+            << std::setw(14) << std::setprecision(1) << per_call << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+
+bool TraceRecorder::write(const std::string& path, std::string& error)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer: buffers)
+    {
+        file << (first ? "" : ",\n")
+             << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->tid
+             << R"(,"args":{"name":"solver )" << buffer->tid << "\"}}";
+        first = false;
+
+        for (const auto& event: buffer->events)
+        {
+            file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"csp\",\"ph\":\"" << event.phase
+                 << "\",\"pid\":1,\"tid\":" << buffer->tid << std::fixed << std::setprecision(3)
+                 << ",\"ts\":" << event.ts;
+            if (event.phase == 'X')
+            {
+                file << ",\"dur\":" << event.dur;
+            }
+            if (event.arg_name != nullptr)
+            {
+                file << ",\"args\":{\"" << event.arg_name << "\":" << event.arg_value << "}";
+            }
+            file << "}";
+        }
+        if (buffer->dropped > 0)
+        {
+            std::cerr << "trace: dropped " << buffer->dropped << " events of thread " << buffer->tid << std::endl;
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+
+TraceRecorder::ThreadBuffer& TraceRecorder::local_buffer()
+{
+    /**
+     * the buffer of the calling thread; it is registered once and owned by the recorder so it outlives the thread
+     */
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->tid = static_cast<int>(buffers.size());
+    }
+    return *buffer;
+}
+
+
+void TraceRecorder::record(const TraceEvent& event)
+{
+    ThreadBuffer& buffer = local_buffer();
+    if (buffer.events.size() < max_events_per_thread)
+    {
+        buffer.events.push_back(event);
+    }
+    else
+    {
+        buffer.dropped++;
+    }
+}
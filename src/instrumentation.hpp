@@ -0,0 +1,371 @@
+#ifndef CSP_INSTRUMENTATION_HPP
+#define CSP_INSTRUMENTATION_HPP
+
+/**
+ * internal header of the csp library: what the search measures about itself. The search counters, the estimate of
+ * the tree size, the progress report, the hardware counters and the trace-event recorder
+ */
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+#ifdef CSP_ALLOC_PROFILE
+// the counters of the replaced global allocation functions (instrumentation.cpp)
+namespace alloc_profile {
+    extern std::atomic<long long> allocations;
+    extern std::atomic<long long> deallocations;
+    extern std::atomic<long long> bytes_allocated;
+    extern std::atomic<long long> live_bytes;
+    extern std::atomic<long long> peak_live_bytes;
+}
+#endif
+
+
+long long get_peak_rss_kb();
+
+
+/**
+ * algorithmic counters collected while searching. They are printed to stderr when the solver is run with --stats
+ */
+struct SearchStats {
+    long long nodes = 0;                // number of times a variable was selected for branching
+    long long consistency_checks = 0;   // number of variable=value pairs checked against the assignment
+    long long failures = 0;             // inconsistent variable=value pairs (the "failure" lines of the trace)
+    long long fc_wipeouts = 0;          // forward checking emptied the domain of a neighbour
+    long long backtracks = 0;           // assignments that were undone
+    long long solutions = 0;
+    long long cache_hits = 0;           // components whose count was found in the component cache
+    long long cache_misses = 0;
+    long long cache_evictions = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // depth profile: index d holds the counters of the nodes with d variables already assigned
+    std::vector<long long> nodes_per_depth;
+    std::vector<long long> failures_per_depth;
+#ifdef CSP_ALLOC_PROFILE
+    // allocation counters when the search started, so that parsing is not charged to the search
+    long long allocations_at_start = 0;
+    long long bytes_at_start = 0;
+#endif
+
+    void start_search()
+    {
+        start = std::chrono::steady_clock::now();
+#ifdef CSP_ALLOC_PROFILE
+        allocations_at_start = alloc_profile::allocations.load();
+        bytes_at_start = alloc_profile::bytes_allocated.load();
+#endif
+    }
+
+    double elapsed_seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void count_node(int depth)
+    {
+        nodes++;
+        if (static_cast<int>(nodes_per_depth.size()) <= depth)
+        {
+            nodes_per_depth.resize(depth + 1, 0);
+            failures_per_depth.resize(depth + 1, 0);
+        }
+        nodes_per_depth[depth]++;
+    }
+
+    void count_failure(int depth)
+    {
+        failures++;
+        failures_per_depth[depth]++;
+    }
+};
+
+
+/**
+ * online estimate of the size of the search tree (Knuth's estimator averaged with the weighted backtrack estimator).
+ * Every leaf reached by the search is a Knuth probe along the current path: with branching factors b1..bd the probe
+ * predicts 1 + b1 + b1*b2 + ... + b1*...*bd nodes. Each probe is weighted by the probability 1/(b1*...*bd) a random
+ * probe would have had of reaching that leaf, which corrects for the left-to-right bias of a systematic search
+ */
+class TreeSizeEstimator {
+public:
+    void enter(int branching)
+    {
+        /**
+         * push an internal node with the given number of children on the current path
+         */
+        double width = branching > 0 ? branching : 1;
+        double parent_width = path_width.empty() ? 1.0 : path_width.back();
+        double parent_sum = path_sum.empty() ? 1.0 : path_sum.back();
+        path_width.push_back(parent_width * width);
+        path_sum.push_back(parent_sum + parent_width * width);
+        visited++;
+    }
+
+    void leave()
+    {
+        path_width.pop_back();
+        path_sum.pop_back();
+    }
+
+    void leaf()
+    {
+        /**
+         * a child of the current node was closed without being expanded
+         */
+        double width = path_width.empty() ? 1.0 : path_width.back();
+        double knuth = path_sum.empty() ? 1.0 : path_sum.back();
+        double weight = 1.0 / width;
+        weighted_sum += weight * knuth;
+        weight_total += weight;
+        visited++;
+    }
+
+    double estimate() const
+    {
+        return weight_total > 0 ? weighted_sum / weight_total : 0.0;
+    }
+
+    long long visited_nodes() const
+    {
+        return visited;
+    }
+
+private:
+    // product of the branching factors from the root to each node of the current path
+    std::vector<double> path_width;
+    // Knuth's estimate for a probe that follows the current path down to each node
+    std::vector<double> path_sum;
+    double weighted_sum = 0.0;
+    double weight_total = 0.0;
+    long long visited = 0;
+};
+
+
+/**
+ * set asynchronously by the SIGUSR1 handler; the search polls it and prints its progress without stopping
+ */
+extern volatile std::sig_atomic_t progress_requested;
+
+extern "C" void request_progress(int);
+
+
+/**
+ * the hot regions of the search that can be measured with hardware counters
+ */
+enum class Region { SelectVariable, SelectValues, ForwardChecking, IsConsistent, Count };
+
+inline const char* region_name(Region region)
+{
+    switch (region)
+    {
+        case Region::SelectVariable: return "select_variable";
+        case Region::SelectValues: return "select_values";
+        case Region::ForwardChecking: return "forward_checking";
+        case Region::IsConsistent: return "is_consistent";
+        default: return "?";
+    }
+}
+
+
+/**
+ * reads cycles, instructions, cache misses and branch mispredicts through linux perf_event_open and accumulates
+ * them per region. All four events are opened as one group so that a single read() returns a consistent snapshot
+ */
+class PerfCounters {
+public:
+    static constexpr int event_count = 4;
+    static constexpr int region_count = static_cast<int>(Region::Count);
+
+    uint64_t totals[region_count][event_count]{};
+    long long calls[region_count]{};
+
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters();
+
+    bool open(std::string& error);
+
+
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+
+    void read_counters(uint64_t values[event_count]) const;
+
+
+    void add(Region region, const uint64_t before[event_count], const uint64_t after[event_count])
+    {
+        int r = static_cast<int>(region);
+        calls[r] += 1;
+        for (int e = 0; e < event_count; e++)
+        {
+            totals[r][e] += after[e] - before[e];
+        }
+    }
+
+
+    void print(std::ostream& out) const;
+
+private:
+    int fds[event_count] = {-1, -1, -1, -1};
+    bool enabled = false;
+};
+
+
+/**
+ * scope guard that charges the hardware counter delta of its lifetime to a region.
+ * When no counters are attached it does nothing
+ */
+class PerfRegion {
+public:
+    PerfRegion(PerfCounters* counters, Region region) : counters(counters), region(region)
+    {
+        if (counters != nullptr)
+        {
+            counters->read_counters(before);
+        }
+    }
+
+    ~PerfRegion()
+    {
+        if (counters != nullptr)
+        {
+            uint64_t after[PerfCounters::event_count];
+            counters->read_counters(after);
+            counters->add(region, before, after);
+        }
+    }
+
+private:
+    PerfCounters* counters;
+    Region region;
+    uint64_t before[PerfCounters::event_count]{};
+};
+
+
+/**
+ * collects chrome trace-event (perfetto compatible) spans and counters. Every thread appends to its own buffer so
+ * recording never takes a lock; the buffers are only merged and written out when the run has finished
+ */
+class TraceRecorder {
+public:
+    // events recorded beyond this many per thread are dropped so a long search cannot exhaust memory
+    static constexpr size_t max_events_per_thread = 4000000;
+
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+
+    void start()
+    {
+        epoch = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+
+
+    double now() const
+    {
+        /**
+         * microseconds since the recorder was started, the time unit of the trace-event format
+         */
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+
+    void complete(const char* name, double start, const char* arg_name = nullptr, long long arg_value = 0)
+    {
+        record({name, 'X', start, now() - start, arg_name, arg_value});
+    }
+
+
+    void counter(const char* name, const char* arg_name, long long arg_value)
+    {
+        record({name, 'C', now(), 0.0, arg_name, arg_value});
+    }
+
+
+    bool write(const std::string& path, std::string& error);
+
+private:
+    struct TraceEvent {
+        const char* name;
+        char phase;
+        double ts;
+        double dur;
+        const char* arg_name;
+        long long arg_value;
+    };
+
+    struct ThreadBuffer {
+        int tid;
+        std::vector<TraceEvent> events;
+        size_t dropped = 0;
+    };
+
+    bool enabled = false;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+
+    ThreadBuffer& local_buffer();
+
+    void record(const TraceEvent& event);
+};
+
+
+/**
+ * the process wide trace; it records nothing unless the solver was started with --trace-json
+ */
+extern TraceRecorder trace_recorder;
+
+
+/**
+ * scope guard that records its lifetime as a complete ("X") trace event
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name(name)
+    {
+        if (trace_recorder.is_enabled())
+        {
+            start = trace_recorder.now();
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if (trace_recorder.is_enabled())
+        {
+            trace_recorder.complete(name, start, arg_name, arg_value);
+        }
+    }
+
+    void set_arg(const char* name_of_arg, long long value)
+    {
+        arg_name = name_of_arg;
+        arg_value = value;
+    }
+
+private:
+    const char* name;
+    double start = 0.0;
+    const char* arg_name = nullptr;
+    long long arg_value = 0;
+};
+
+#endif
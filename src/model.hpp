@@ -0,0 +1,758 @@
+#ifndef CSP_MODEL_HPP
+#define CSP_MODEL_HPP
+
+/**
+ * internal header of the csp library: the domains, the binary and n-ary constraints, the model they are built into
+ * and the readers of the variable and constraint files. Nothing in here searches
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+inline long long floor_div(long long a, long long b)
+{
+    long long quotient = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? quotient - 1 : quotient;
+}
+
+
+inline long long ceil_div(long long a, long long b)
+{
+    long long quotient = a / b;
+    return (a % b != 0 && ((a < 0) == (b < 0))) ? quotient + 1 : quotient;
+}
+
+
+/**
+ * struct to represent a constraint "var1 op coef * var2 + offset". A unary constraint "var1 op offset" has no var2 (0).
+ * The operators are = ! < > and L for <=, G for >=
+ */
+struct Constraint {
+    char var1;
+    char var2;
+    char op;
+    int coef = 1;
+    int offset = 0;
+
+
+    bool is_unary() const
+    {
+        return var2 == 0 || coef == 0;
+    }
+
+
+    bool holds(long long value1, long long value2) const
+    {
+        /**
+         * check the constraint for var1 = value1 and var2 = value2
+         */
+        long long right = static_cast<long long>(coef) * value2 + offset;
+        switch (op)
+        {
+            case '=': return value1 == right;
+            case '!': return value1 != right;
+            case '<': return value1 < right;
+            case '>': return value1 > right;
+            case 'L': return value1 <= right;
+            case 'G': return value1 >= right;
+            default: return false;
+        }
+    }
+
+
+    std::pair<long long, long long> supports(bool from_var1, long long lo, long long hi) const
+    {
+        /**
+         * for every operator but '!': the smallest range of the other variable that holds all the values compatible
+         * with some value in [lo, hi] of the variable on the from_var1 side. The relation is monotone, so this is
+         * exact for a single value and the bounds-consistent hull for a range. The range is empty when first > second
+         */
+        if (!from_var1)
+        {
+            // var2 in [lo, hi]: the right hand side coef * var2 + offset covers [right_lo, right_hi]
+            long long right_lo = coef > 0 ? coef * lo + offset : coef * hi + offset;
+            long long right_hi = coef > 0 ? coef * hi + offset : coef * lo + offset;
+            switch (op)
+            {
+                case '<': return {LLONG_MIN, right_hi - 1};
+                case 'L': return {LLONG_MIN, right_hi};
+                case '>': return {right_lo + 1, LLONG_MAX};
+                case 'G': return {right_lo, LLONG_MAX};
+                default: return {right_lo, right_hi};
+            }
+        }
+
+        // var1 in [lo, hi]: find the bounds on coef * var2, then divide them by coef
+        long long product_lo = LLONG_MIN;
+        long long product_hi = LLONG_MAX;
+        switch (op)
+        {
+            case '<': product_lo = lo - offset + 1; break;
+            case 'L': product_lo = lo - offset; break;
+            case '>': product_hi = hi - offset - 1; break;
+            case 'G': product_hi = hi - offset; break;
+            default: product_lo = lo - offset; product_hi = hi - offset; break;
+        }
+        if (coef < 0)
+        {
+            std::swap(product_lo, product_hi);
+        }
+        long long first = product_lo == LLONG_MIN || product_lo == LLONG_MAX ? product_lo : ceil_div(product_lo, coef);
+        long long last = product_hi == LLONG_MIN || product_hi == LLONG_MAX ? product_hi : floor_div(product_hi, coef);
+        if (coef < 0)
+        {
+            // the infinite bounds were swapped along with the finite ones, so they point the wrong way now
+            first = first == LLONG_MAX ? LLONG_MIN : first;
+            last = last == LLONG_MIN ? LLONG_MAX : last;
+        }
+        return {first, last};
+    }
+
+
+    bool excluded_value(bool from_var1, long long value, long long& excluded) const
+    {
+        /**
+         * for '!': the single value of the other variable that is ruled out by the value on the from_var1 side.
+         * Returns false when no integer is ruled out
+         */
+        if (!from_var1)
+        {
+            excluded = static_cast<long long>(coef) * value + offset;
+            return true;
+        }
+        if ((value - offset) % coef != 0)
+        {
+            return false;
+        }
+        excluded = (value - offset) / coef;
+        return true;
+    }
+};
+
+
+inline std::string operator_symbol(char op)
+{
+    switch (op)
+    {
+        case 'L': return "<=";
+        case 'G': return ">=";
+        default: return std::string(1, op);
+    }
+}
+
+
+/**
+ * the domain of a variable: a set of integers stored as a sorted list of disjoint, non-adjacent intervals.
+ * Listed values and ranges such as 0..1000000 use the same representation, so a domain costs memory per run of
+ * consecutive values instead of per value. Every interval also stores how many values come before it, so the
+ * counting queries are binary searches. The values can be iterated like a container
+ */
+class Domain {
+public:
+    struct Interval {
+        int lo;
+        int hi;
+        // number of values in the intervals in front of this one
+        long long before;
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = long long;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator(const Interval* interval, const Interval* last, long long value)
+                : interval(interval), last(last), value(value) {}
+
+        int operator*() const
+        {
+            return static_cast<int>(value);
+        }
+
+        const_iterator& operator++()
+        {
+            if (value < interval->hi)
+            {
+                value++;
+            }
+            else
+            {
+                interval++;
+                value = interval != last ? interval->lo : 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return interval == other.interval && value == other.value;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        const Interval* interval;
+        const Interval* last;
+        long long value;
+    };
+
+    Domain() = default;
+
+    explicit Domain(std::vector<std::pair<int, int>> ranges)
+    {
+        /**
+         * build a domain from inclusive ranges given in any order; overlapping and touching ranges are merged
+         */
+        std::sort(ranges.begin(), ranges.end());
+        for (const auto& range: ranges)
+        {
+            if (range.first > range.second)
+            {
+                continue;
+            }
+            if (!intervals.empty() && static_cast<long long>(range.first) <= static_cast<long long>(intervals.back().hi) + 1)
+            {
+                intervals.back().hi = std::max(intervals.back().hi, range.second);
+            }
+            else
+            {
+                intervals.push_back({range.first, range.second, 0});
+            }
+        }
+        recount(0);
+    }
+
+    const_iterator begin() const
+    {
+        return intervals.empty() ? end() : const_iterator(data(), data() + intervals.size(), intervals.front().lo);
+    }
+
+    const_iterator end() const
+    {
+        return {data() + intervals.size(), data() + intervals.size(), 0};
+    }
+
+    long long size() const
+    {
+        return total;
+    }
+
+    bool empty() const
+    {
+        return total == 0;
+    }
+
+    int min() const
+    {
+        return intervals.front().lo;
+    }
+
+    int max() const
+    {
+        return intervals.back().hi;
+    }
+
+    const std::vector<Interval>& get_intervals() const
+    {
+        return intervals;
+    }
+
+
+    bool contains(int value) const
+    {
+        size_t index = find(value);
+        return index < intervals.size() && intervals[index].lo <= value;
+    }
+
+
+    long long count_less(int value) const
+    {
+        /**
+         * number of values smaller than value
+         */
+        size_t index = find(value);
+        if (index == intervals.size())
+        {
+            return total;
+        }
+        const Interval& interval = intervals[index];
+        if (interval.lo >= value)
+        {
+            return interval.before;
+        }
+        return interval.before + (static_cast<long long>(value) - interval.lo);
+    }
+
+
+    long long count_greater(int value) const
+    {
+        /**
+         * number of values larger than value
+         */
+        return total - count_less(value) - (contains(value) ? 1 : 0);
+    }
+
+
+    long long count_range(long long lo, long long hi) const
+    {
+        /**
+         * number of values in [lo, hi]
+         */
+        if (empty() || lo > hi || lo > max() || hi < min())
+        {
+            return 0;
+        }
+        int first = static_cast<int>(std::max<long long>(lo, min()));
+        int last = static_cast<int>(std::min<long long>(hi, max()));
+        return count_less(last) + (contains(last) ? 1 : 0) - count_less(first);
+    }
+
+
+    bool restrict(long long lo, long long hi)
+    {
+        /**
+         * keep only the values in [lo, hi]. Returns true if the domain changed
+         */
+        long long before = total;
+        if (lo > hi || intervals.empty() || lo > intervals.back().hi || hi < intervals.front().lo)
+        {
+            intervals.clear();
+            total = 0;
+            return before != 0;
+        }
+
+        // drop the intervals that end below lo and the ones that start above hi, then clip the two ends
+        auto first = std::lower_bound(intervals.begin(), intervals.end(), lo,
+                                      [](const Interval& interval, long long bound) { return interval.hi < bound; });
+        auto last = std::upper_bound(intervals.begin(), intervals.end(), hi,
+                                     [](long long bound, const Interval& interval) { return bound < interval.lo; });
+        intervals.erase(last, intervals.end());
+        intervals.erase(intervals.begin(), first);
+        if (intervals.empty())
+        {
+            total = 0;
+            return before != 0;
+        }
+        intervals.front().lo = static_cast<int>(std::max<long long>(intervals.front().lo, lo));
+        intervals.back().hi = static_cast<int>(std::min<long long>(intervals.back().hi, hi));
+        recount(0);
+        return total != before;
+    }
+
+
+    bool remove(int value)
+    {
+        /**
+         * remove one value, splitting its interval when the value is in the middle. Returns true if it was there
+         */
+        size_t index = find(value);
+        if (index == intervals.size() || intervals[index].lo > value)
+        {
+            return false;
+        }
+
+        Interval& interval = intervals[index];
+        if (interval.lo == interval.hi)
+        {
+            intervals.erase(intervals.begin() + static_cast<long>(index));
+        }
+        else if (interval.lo == value)
+        {
+            interval.lo++;
+        }
+        else if (interval.hi == value)
+        {
+            interval.hi--;
+        }
+        else
+        {
+            Interval upper{value + 1, interval.hi, 0};
+            interval.hi = value - 1;
+            intervals.insert(intervals.begin() + static_cast<long>(index) + 1, upper);
+        }
+        recount(index);
+        return true;
+    }
+
+
+    void restore(const Interval* first, size_t count)
+    {
+        /**
+         * replace the content with intervals saved earlier
+         */
+        intervals.assign(first, first + count);
+        total = intervals.empty() ? 0 : intervals.back().before + interval_size(intervals.back());
+    }
+
+private:
+    std::vector<Interval> intervals;
+    long long total = 0;
+
+    const Interval* data() const
+    {
+        return intervals.data();
+    }
+
+    static long long interval_size(const Interval& interval)
+    {
+        return static_cast<long long>(interval.hi) - interval.lo + 1;
+    }
+
+    size_t find(int value) const
+    {
+        /**
+         * index of the first interval that ends at or after value
+         */
+        auto found = std::lower_bound(intervals.begin(), intervals.end(), value,
+                                      [](const Interval& interval, int bound) { return interval.hi < bound; });
+        return static_cast<size_t>(found - intervals.begin());
+    }
+
+    void recount(size_t from)
+    {
+        /**
+         * recompute the running counts from the interval at index from onwards
+         */
+        long long count = from == 0 ? 0 : intervals[from - 1].before + interval_size(intervals[from - 1]);
+        for (size_t index = from; index < intervals.size(); index++)
+        {
+            intervals[index].before = count;
+            count += interval_size(intervals[index]);
+        }
+        total = count;
+    }
+};
+
+
+class CSP;
+
+
+/**
+ * a constraint over any number of variables that filters the domains with its own algorithm. Binary constraints are
+ * handled by the search itself; everything else is checked and propagated through this interface
+ */
+class Propagator {
+public:
+    // the variables of the constraint
+    std::vector<char> scope;
+    // where the search state of the constraint starts in the propagator state of a csp; set when the model is built
+    size_t state_offset = 0;
+
+    virtual ~Propagator() = default;
+
+    // build the data that stays the same during every search against the initial domains, removing the values that
+    // no solution of the constraint uses. Returns the number of words of search state the constraint needs
+    virtual size_t prepare(std::unordered_map<char, Domain>& domains) = 0;
+
+    // write the initial search state and filter the initial domains. Returns false if the constraint can never be
+    // satisfied
+    virtual bool initialize(CSP& csp) const = 0;
+
+    // check variable=value against the assigned variables of the scope
+    virtual bool is_consistent(const CSP& csp, char variable, int value) const = 0;
+
+    // remove the values of the unassigned variables of the scope that lost their support. Every change to a domain
+    // or to the state of the propagator goes through the trail of the csp. Returns false on a wipeout
+    virtual bool propagate(CSP& csp) const = 0;
+
+    // check a complete assignment
+    virtual bool holds(const CSP& csp) const = 0;
+
+    // told about every variable of the scope that was assigned or whose domain changed, before propagate runs.
+    // Propagators that keep incremental state update it here
+    virtual void notify(CSP&, char) const {}
+
+    virtual std::string describe() const = 0;
+
+    // the constraint without the names of its variables, for the canonical hash of the result cache
+    virtual std::string signature() const = 0;
+
+    bool involves(char variable) const
+    {
+        return std::find(scope.begin(), scope.end(), variable) != scope.end();
+    }
+
+protected:
+    // the search state of the constraint in a csp
+    uint64_t* state(CSP& csp) const;
+    const uint64_t* state(const CSP& csp) const;
+};
+
+
+/**
+ * extensional (table) constraint: the scope may only take one of the listed tuples. Propagated with Compact-Table:
+ * the tuples that are still valid are a reversible sparse bitset, and every value keeps a bitset of the tuples that
+ * support it. A value loses its support when its bitset no longer intersects the valid tuples
+ */
+class TableConstraint : public Propagator {
+public:
+    TableConstraint(std::vector<char> variables, std::vector<std::vector<int>> tuples)
+            : tuples(std::move(tuples))
+    {
+        scope = std::move(variables);
+    }
+
+    size_t prepare(std::unordered_map<char, Domain>& domains) override;
+    bool initialize(CSP& csp) const override;
+    bool is_consistent(const CSP& csp, char variable, int value) const override;
+    bool propagate(CSP& csp) const override;
+    bool holds(const CSP& csp) const override;
+    std::string describe() const override;
+    std::string signature() const override;
+
+private:
+    std::vector<std::vector<int>> tuples;
+    size_t word_count = 0;
+    // for every variable of the scope: its values that appear in a valid tuple (sorted), and for each of those
+    // values word_count words with the bits of the tuples using it
+    std::vector<std::vector<int>> support_values;
+    std::vector<std::vector<uint64_t>> supports;
+    // where the residues of every variable of the scope start in the search state
+    std::vector<size_t> residue_offset;
+
+    /**
+     * the search state, in this order:
+     *     words      reversible sparse bitset of the valid tuples, word_count words
+     *     index      the non-zero words are listed in index[0, limit), word_count words
+     *     limit      one word
+     *     last_size  reversible size of every domain at the last update, to skip the variables that did not change
+     *     residues   for every supported value the last word where a support was found; only a hint, not trailed
+     */
+    struct State {
+        uint64_t* words;
+        uint64_t* index;
+        uint64_t& limit;
+        uint64_t* last_size;
+        uint64_t* residues;
+    };
+
+    State state_of(CSP& csp) const;
+    long value_index(size_t position, int value) const;
+    const uint64_t* support_words(size_t position, long value) const;
+    bool intersects_assigned(const CSP& csp, char variable, int value) const;
+};
+
+
+/**
+ * global all-different constraint: the variables of the scope take pairwise different values. By default it is
+ * propagated with Régin's algorithm (domain consistency through a maximum matching between the variables and the
+ * values); bounds_only switches to the cheaper bounds consistency based on Hall intervals
+ */
+class AllDifferent : public Propagator {
+public:
+    bool bounds_only = false;
+
+    explicit AllDifferent(std::vector<char> variables)
+    {
+        scope = std::move(variables);
+    }
+
+    size_t prepare(std::unordered_map<char, Domain>& domains) override;
+    bool initialize(CSP& csp) const override;
+    bool is_consistent(const CSP& csp, char variable, int value) const override;
+    bool propagate(CSP& csp) const override;
+    bool holds(const CSP& csp) const override;
+    std::string describe() const override;
+    std::string signature() const override;
+
+private:
+    // domains with more values than this in total are only propagated on their bounds
+    static constexpr long long max_matching_values = 100000;
+
+    // the search state is the value every variable was matched to the last time; only a starting point for the next
+    // matching, so it is not trailed
+    bool propagate_matching(CSP& csp) const;
+    bool propagate_bounds(CSP& csp) const;
+};
+
+
+/**
+ * linear constraint "a1*X1 + a2*X2 + ... op c" over any number of variables, with op one of = ! < > <= >=. It keeps
+ * the smallest and largest value the sum can take as running totals: a changed variable only adds the difference of
+ * its own term, and the domains are narrowed only when the slack of the sum is smaller than the widest term
+ */
+class LinearConstraint : public Propagator {
+public:
+    LinearConstraint(std::vector<std::pair<char, long long>> terms, char op, long long right);
+
+    size_t prepare(std::unordered_map<char, Domain>& domains) override;
+    bool initialize(CSP& csp) const override;
+    bool is_consistent(const CSP& csp, char variable, int value) const override;
+    bool propagate(CSP& csp) const override;
+    bool holds(const CSP& csp) const override;
+    void notify(CSP& csp, char variable) const override;
+    std::string describe() const override;
+    std::string signature() const override;
+
+protected:
+    std::vector<long long> coefs;
+    char op;
+    long long right;
+    // the sum must lie in [lower, upper]; '!' only excludes right
+    long long lower = LLONG_MIN;
+    long long upper = LLONG_MAX;
+    // an objective: the sum must also stay below the objective bound of the csp
+    bool bounded_by_incumbent = false;
+
+private:
+    // no term was ever wider than this, so a slack at least this large cannot narrow any domain
+    long long widest_term = 0;
+    // the position of every variable in the scope
+    std::vector<int> position_of = std::vector<int>(256, -1);
+
+    long long upper_limit(const CSP& csp) const;
+
+    // the search state is reversible on the word trail: the smallest and largest sum, then the smallest and largest
+    // value of every term as it was last counted in the sums
+    long long word(const CSP& csp, size_t index) const
+    {
+        return static_cast<long long>(state(csp)[index]);
+    }
+
+    void set_word(CSP& csp, size_t index, long long value) const;
+    std::pair<long long, long long> term_range(const CSP& csp, size_t position) const;
+};
+
+
+/**
+ * the objective of an optimization problem, "minimize 2*A + B" or "maximize A - C". It is a linear constraint on the
+ * sum to minimize whose bound is the best solution found so far, so as soon as there is one the search prunes every
+ * branch whose smallest possible sum cannot beat it, and with forward checking narrows the domains to what could
+ */
+class Objective : public LinearConstraint {
+public:
+    Objective(std::vector<std::pair<char, long long>> terms, bool maximize, long long constant);
+
+    // the sum that is minimized, which a maximized objective negates, of a complete assignment
+    long long sum(const CSP& csp) const;
+
+    // the value of the objective as written, of a complete assignment
+    long long value(const CSP& csp) const;
+
+    std::string describe() const override;
+    std::string signature() const override;
+
+private:
+    bool maximize;
+    long long constant;
+};
+
+
+/**
+ * the part of a problem that no search changes: the initial domains, the constraints and which variables they
+ * involve. It is built once and shared read-only by every search of the problem, each of which keeps its own
+ * assignment, domains and propagator state in a CSP
+ */
+class Model {
+public:
+    // the domains after the unary constraints and the initial filtering of the n-ary constraints
+    std::unordered_map<char, Domain> domain;
+    // the binary constraints, and for every variable the indices of the ones it is part of
+    std::vector<Constraint> constraints;
+    std::unordered_map<char, std::vector<size_t>> constraints_of;
+    // the n-ary constraints, and for every variable the indices of the ones it is part of
+    std::vector<std::unique_ptr<Propagator>> propagators;
+    std::unordered_map<char, std::vector<size_t>> propagators_of;
+    // the search state of all n-ary constraints at the root, one after another
+    std::vector<uint64_t> propagator_state;
+    // the objective among the propagators, if the problem has one
+    const Objective* objective = nullptr;
+    // an n-ary constraint can never be satisfied with the initial domains, so no search has to look for a solution
+    bool infeasible = false;
+};
+
+
+std::shared_ptr<const Model> build_model(std::unordered_map<char, Domain> variables,
+                                         const std::vector<Constraint>& constraints,
+                                         std::vector<std::unique_ptr<Propagator>> propagators);
+
+
+/**
+ * what is wrong with a problem that build_model would have to work around: a constraint on a variable without a domain,
+ * or more than one objective. Empty if nothing is
+ */
+std::vector<std::string> check_problem(const std::unordered_map<char, Domain>& variables,
+                                       const std::vector<Constraint>& constraints,
+                                       const std::vector<std::unique_ptr<Propagator>>& propagators);
+
+
+/**
+ * what preprocess_network did to the network
+ */
+struct PreprocessResult {
+    size_t removed_constraints = 0;
+    // (variable, the variable it was merged into)
+    std::vector<std::pair<char, char>> merged;
+    // a pair of constraints that can never hold together; the domain of its first variable has been emptied
+    bool unsatisfiable = false;
+    std::string conflict;
+};
+
+
+std::vector<std::unique_ptr<Propagator>> detect_alldiff_cliques(std::vector<Constraint>& constraints);
+
+
+/**
+ * the all-different setup shared by the command line and the library: with detect, the cliques of '!' constraints
+ * become all-different propagators, and then every all-different propagator is switched to bounds consistency or to
+ * matching
+ */
+void add_alldiff_propagators(std::vector<Constraint>& constraints, std::vector<std::unique_ptr<Propagator>>& propagators,
+                             bool detect, bool bounds_only);
+
+
+std::vector<std::vector<char>> connected_components(const std::unordered_map<char, Domain>& variables,
+                                                    const std::vector<Constraint>& constraints,
+                                                    const std::vector<std::unique_ptr<Propagator>>& propagators);
+
+
+/**
+ * the parsers skip what they cannot read and describe it in errors, which is left for the caller to report
+ */
+std::unordered_map<char, Domain> parse_variables (std::istream& input, std::vector<std::string>& errors);
+
+std::unordered_map<char, Domain> get_variables_from_file (const std::string& var_file_path,
+                                                          std::vector<std::string>& errors);
+
+
+bool parse_constraint(const std::string& line, Constraint& constraint);
+
+
+bool parse_linear(const std::string& line, std::vector<std::pair<char, long long>>& terms, char& op, long long& right);
+
+
+char flip_operator(char op);
+
+
+std::vector<Constraint> parse_constraints (std::istream& input, std::vector<std::unique_ptr<Propagator>>& propagators,
+                                           std::vector<std::string>& errors);
+
+std::vector<Constraint> get_constraints_from_file (const std::string& const_file_path,
+                                                    std::vector<std::unique_ptr<Propagator>>& propagators,
+                                                    std::vector<std::string>& errors);
+
+
+PreprocessResult preprocess_network(std::unordered_map<char, Domain>& variables, std::vector<Constraint>& constraints,
+                                    const std::vector<std::unique_ptr<Propagator>>& propagators);
+
+
+void print_solution(long long number, const std::vector<char>& order, const std::unordered_map<char, int>& solution,
+                    const std::vector<std::pair<char, char>>& merged);
+
+#endif
@@ -0,0 +1,353 @@
+#include "result_cache.hpp"
+#include "solver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+
+bool ResultCache::read(const std::string& digest, const std::string& kind, std::string& value) const
+{
+    std::ifstream file(path(digest));
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, kind.size(), kind) == 0 && (line.size() == kind.size() || line[kind.size()] == ' '))
+        {
+            value = line.size() > kind.size() ? line.substr(kind.size() + 1) : "";
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool ResultCache::write(const std::string& digest, const std::string& kind, const std::string& value, std::string& error) const
+{
+    std::error_code code;
+    std::filesystem::create_directories(directory, code);
+    if (code)
+    {
+        error = "cannot create " + directory + ": " + code.message();
+        return false;
+    }
+
+    // keep the other kinds of results already stored
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path(digest));
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, kind.size(), kind) != 0)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+    lines.push_back(value.empty() ? kind : kind + " " + value);
+
+    std::random_device random;
+    std::string temporary = path(digest) + ".tmp." + std::to_string(random()) + std::to_string(random());
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        for (const auto& line: lines)
+        {
+            file << line << "\n";
+        }
+        file.flush();
+        if (!file)
+        {
+            error = "cannot write " + temporary;
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path(digest).c_str()) != 0)
+    {
+        error = "cannot rename " + temporary + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+uint64_t fnv1a(const std::string& text, uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char c: text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+ProblemHash canonical_hash(const CSP& csp)
+{
+    /**
+     * a hash of the domains and constraints that does not depend on their order nor on the names of the variables.
+     * Every variable starts with the color of its domain and is recolored with the colors of its neighbours and the
+     * constraints to them (Weisfeiler-Leman refinement) until the number of colors stops growing. The digest then
+     * covers the sorted colors and the constraints written with colors instead of names
+     */
+    ProblemHash result;
+    std::vector<char> names;
+    for (const auto& entry: csp.domain)
+    {
+        names.push_back(entry.first);
+        std::string text = "domain";
+        for (const auto& interval: entry.second.get_intervals())
+        {
+            text += " " + std::to_string(interval.lo) + ".." + std::to_string(interval.hi);
+        }
+        result.colors[entry.first] = fnv1a(text);
+    }
+    std::sort(names.begin(), names.end());
+
+    auto color = [&](char variable) {
+        auto found = result.colors.find(variable);
+        return found != result.colors.end() ? std::to_string(found->second) : std::string("?");
+    };
+    auto label = [](const Constraint& constraint) {
+        return std::string(1, constraint.op) + " " + std::to_string(constraint.coef) + " " +
+               std::to_string(constraint.offset);
+    };
+    auto scope_colors = [&](const Propagator& propagator) {
+        std::string text;
+        for (char variable: propagator.scope)
+        {
+            text += color(variable) + ",";
+        }
+        return text;
+    };
+
+    auto distinct = [&]() {
+        std::vector<uint64_t> seen;
+        for (const auto& entry: result.colors)
+        {
+            seen.push_back(entry.second);
+        }
+        std::sort(seen.begin(), seen.end());
+        return static_cast<size_t>(std::unique(seen.begin(), seen.end()) - seen.begin());
+    };
+
+    size_t classes = distinct();
+    for (size_t round = 0; round < names.size(); round++)
+    {
+        std::unordered_map<char, std::vector<std::string>> around;
+        for (const auto& constraint: csp.constraints)
+        {
+            around[constraint.var1].push_back("1 " + label(constraint) + " " + color(constraint.var2));
+            around[constraint.var2].push_back("2 " + label(constraint) + " " + color(constraint.var1));
+        }
+        for (const auto& propagator: csp.propagators)
+        {
+            std::string text = propagator->signature() + " " + scope_colors(*propagator);
+            for (size_t position = 0; position < propagator->scope.size(); position++)
+            {
+                around[propagator->scope[position]].push_back("p " + std::to_string(position) + " " + text);
+            }
+        }
+
+        std::unordered_map<char, uint64_t> refined;
+        for (char variable: names)
+        {
+            std::vector<std::string>& descriptions = around[variable];
+            std::sort(descriptions.begin(), descriptions.end());
+            std::string text = color(variable);
+            for (const auto& description: descriptions)
+            {
+                text += ";" + description;
+            }
+            refined[variable] = fnv1a(text);
+        }
+        result.colors = std::move(refined);
+
+        size_t refined_classes = distinct();
+        if (refined_classes == classes)
+        {
+            break;
+        }
+        classes = refined_classes;
+    }
+
+    std::vector<std::string> parts;
+    for (char variable: names)
+    {
+        parts.push_back("v " + color(variable));
+    }
+    for (const auto& constraint: csp.constraints)
+    {
+        parts.push_back("c " + label(constraint) + " " + color(constraint.var1) + " " + color(constraint.var2));
+    }
+    for (const auto& propagator: csp.propagators)
+    {
+        parts.push_back("p " + propagator->signature() + " " + scope_colors(*propagator));
+    }
+    std::sort(parts.begin(), parts.end());
+    std::string text;
+    for (const auto& part: parts)
+    {
+        text += part + "\n";
+    }
+
+    auto hex_digest = [](const std::string& text) {
+        char digest[33];
+        std::snprintf(digest, sizeof(digest), "%016llx%016llx", static_cast<unsigned long long>(fnv1a(text)),
+                      static_cast<unsigned long long>(fnv1a(text, 0x6c62272e07bb0142ULL)));
+        return std::string(digest);
+    };
+    result.digest = hex_digest(text);
+
+    // the same problem with the names of the variables, on one line; only the order of its parts is canonical
+    parts.clear();
+    for (char variable: names)
+    {
+        std::string part = std::string("v ") + variable;
+        for (const auto& interval: csp.domain.at(variable).get_intervals())
+        {
+            part += " " + std::to_string(interval.lo) + ".." + std::to_string(interval.hi);
+        }
+        parts.push_back(part);
+    }
+    for (const auto& constraint: csp.constraints)
+    {
+        parts.push_back("c " + label(constraint) + " " + constraint.var1 + " " + constraint.var2);
+    }
+    for (const auto& propagator: csp.propagators)
+    {
+        parts.push_back("p " + propagator->signature() + " " +
+                        std::string(propagator->scope.begin(), propagator->scope.end()));
+    }
+    std::sort(parts.begin(), parts.end());
+    for (const auto& part: parts)
+    {
+        result.serialization += part + "|";
+    }
+    result.exact_digest = hex_digest(result.serialization);
+    return result;
+}
+
+
+bool use_cached_result(CSP& csp, const ResultCache& cache, const ProblemHash& hash)
+{
+    /**
+     * answer from the cache if it holds the kind of result asked for. Unsat and counts are only used for exactly this
+     * problem; a cached solution is given to the variables color by color and only used if it really solves it
+     */
+    std::string value;
+    std::string problem;
+    bool exact = cache.read(hash.exact_digest, "problem", problem) && problem == hash.serialization;
+    if (exact && cache.read(hash.exact_digest, "unsat", value))
+    {
+        if (csp.count_all)
+        {
+            std::cout << "solutions: 0" << std::endl;
+        }
+        return true;
+    }
+    if (csp.count_all)
+    {
+        if (!exact || !cache.read(hash.exact_digest, "count", value))
+        {
+            return false;
+        }
+        csp.stats.solutions = static_cast<long long>(std::stoull(value));
+        std::cout << "solutions: " << value << std::endl;
+        return true;
+    }
+    if (!cache.read(hash.digest, "solution", value))
+    {
+        return false;
+    }
+
+    // the cached values of every color, and the variables of every color in order of their names
+    std::unordered_map<uint64_t, std::vector<int>> cached_values;
+    std::istringstream pairs(value);
+    std::string pair;
+    while (pairs >> pair)
+    {
+        size_t colon = pair.find(':');
+        if (colon == std::string::npos)
+        {
+            return false;
+        }
+        cached_values[std::stoull(pair.substr(0, colon))].push_back(std::stoi(pair.substr(colon + 1)));
+    }
+    std::vector<char> order;
+    for (const auto& entry: csp.domain)
+    {
+        order.push_back(entry.first);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::unordered_map<uint64_t, size_t> used;
+    for (char variable: order)
+    {
+        const std::vector<int>& values = cached_values[hash.colors.at(variable)];
+        size_t& next = used[hash.colors.at(variable)];
+        if (next == values.size() || !csp.domain.at(variable).contains(values[next]))
+        {
+            csp.assignment.clear();
+            return false;
+        }
+        csp.assignment[variable] = values[next++];
+    }
+    bool complete = std::all_of(csp.constraints.begin(), csp.constraints.end(), [&](const Constraint& constraint) {
+        return csp.assignment.count(constraint.var1) && csp.assignment.count(constraint.var2);
+    });
+    if (!complete || !csp.is_solution())
+    {
+        csp.assignment.clear();
+        return false;
+    }
+    csp.stats.solutions = 1;
+    csp.print_success(order, 1);
+    return true;
+}
+
+
+void store_result(const CSP& csp, const ResultCache& cache, const ProblemHash& hash)
+{
+    /**
+     * remember the result of a finished search
+     */
+    std::string error;
+    bool stored = true;
+    if (csp.stats.solutions == 0 || csp.count_all)
+    {
+        // written with the exact problem they belong to, which has to be there first
+        stored = cache.write(hash.exact_digest, "problem", hash.serialization, error) &&
+                 (csp.stats.solutions == 0
+                          ? cache.write(hash.exact_digest, "unsat", "", error)
+                          : cache.write(hash.exact_digest, "count",
+                                        std::to_string(static_cast<unsigned long long>(csp.stats.solutions)), error));
+    }
+    else
+    {
+        std::vector<std::pair<uint64_t, char>> order;
+        for (const auto& entry: csp.assignment)
+        {
+            order.emplace_back(hash.colors.at(entry.first), entry.first);
+        }
+        std::sort(order.begin(), order.end());
+        std::string value;
+        for (const auto& variable: order)
+        {
+            value += (value.empty() ? "" : " ") + std::to_string(variable.first) + ":" +
+                     std::to_string(csp.assignment.at(variable.second));
+        }
+        stored = cache.write(hash.digest, "solution", value, error);
+    }
+    if (!stored)
+    {
+        std::cerr << "result cache: " << error << std::endl;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef CSP_RESULT_CACHE_HPP
+#define CSP_RESULT_CACHE_HPP
+
+/**
+ * internal header of the csp library: the on-disk cache of results keyed on a canonical hash of the problem
+ */
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+
+class CSP;
+
+
+/**
+ * canonical hash of a loaded problem: its 128 bit hex digest, and the color every variable ended up with. Color
+ * refinement cannot tell every pair of different problems apart, so the digest is only trusted for solutions, which are
+ * checked before they are used. Unsat and count results are kept under the digest of the exact problem, written out
+ * with the names of its variables in serialization, and only used when that matches too
+ */
+struct ProblemHash {
+    std::string digest;
+    std::unordered_map<char, uint64_t> colors;
+    std::string exact_digest;
+    std::string serialization;
+};
+
+
+/**
+ * results of past runs on disk, one file per problem digest with a line per kind of result:
+ *     solution <color>:<value> ...
+ * and one per exact digest with the problem it was computed for:
+ *     problem <serialization>
+ *     unsat
+ *     count <n>
+ * A file is replaced as a whole by renaming a complete temporary file over it, so concurrent readers and writers only
+ * ever see whole files (the last writer wins)
+ */
+class ResultCache {
+public:
+    explicit ResultCache(std::string directory) : directory(std::move(directory))
+    {
+    }
+
+
+    bool read(const std::string& digest, const std::string& kind, std::string& value) const;
+
+    bool write(const std::string& digest, const std::string& kind, const std::string& value, std::string& error) const;
+
+private:
+    std::string directory;
+
+    std::string path(const std::string& digest) const
+    {
+        return directory + "/" + digest + ".result";
+    }
+};
+
+
+ProblemHash canonical_hash(const CSP& csp);
+
+
+bool use_cached_result(CSP& csp, const ResultCache& cache, const ProblemHash& hash);
+
+
+void store_result(const CSP& csp, const ResultCache& cache, const ProblemHash& hash);
+
+#endif
@@ -0,0 +1,3186 @@
+#include "solver.hpp"
+#include "generator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+
+size_t TableConstraint::prepare(std::unordered_map<char, Domain>& domains)
+{
+    /**
+     * drop the tuples with a value outside the initial domains, build the support bitsets of every value and remove
+     * the values that appear in no valid tuple
+     */
+    const size_t arity = scope.size();
+    tuples.erase(std::remove_if(tuples.begin(), tuples.end(), [&](const std::vector<int>& tuple) {
+        for (size_t position = 0; position < arity; position++)
+        {
+            if (!domains.at(scope[position]).contains(tuple[position]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }), tuples.end());
+
+    word_count = (tuples.size() + 63) / 64;
+    support_values.assign(arity, {});
+    supports.assign(arity, {});
+    residue_offset.assign(arity, 0);
+    size_t state_size = 2 * word_count + 1 + arity;
+    for (size_t position = 0; position < arity; position++)
+    {
+        std::vector<int>& values = support_values[position];
+        for (const auto& tuple: tuples)
+        {
+            values.push_back(tuple[position]);
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        supports[position].assign(values.size() * word_count, 0);
+        residue_offset[position] = state_size;
+        state_size += values.size();
+        for (size_t tuple = 0; tuple < tuples.size(); tuple++)
+        {
+            long value = value_index(position, tuples[tuple][position]);
+            supports[position][static_cast<size_t>(value) * word_count + tuple / 64] |= uint64_t{1} << (tuple % 64);
+        }
+    }
+
+    // a value that no tuple uses can go right away
+    for (size_t position = 0; position < arity; position++)
+    {
+        std::vector<std::pair<int, int>> kept;
+        for (int value: support_values[position])
+        {
+            kept.emplace_back(value, value);
+        }
+        domains.at(scope[position]) = Domain(std::move(kept));
+    }
+    return state_size;
+}
+
+
+TableConstraint::State TableConstraint::state_of(CSP& csp) const
+{
+    uint64_t* words = state(csp);
+    return {words, words + word_count, words[2 * word_count], words + 2 * word_count + 1, words};
+}
+
+
+bool TableConstraint::initialize(CSP& csp) const
+{
+    State current = state_of(csp);
+    std::fill(current.words, current.words + word_count, ~uint64_t{0});
+    if (tuples.size() % 64 != 0)
+    {
+        current.words[word_count - 1] = (uint64_t{1} << (tuples.size() % 64)) - 1;
+    }
+    for (size_t word = 0; word < word_count; word++)
+    {
+        current.index[word] = word;
+    }
+    current.limit = word_count;
+    std::fill(current.last_size, current.last_size + scope.size(), 0);
+
+    bool feasible = !tuples.empty();
+    for (char variable: scope)
+    {
+        feasible = feasible && !csp.domain.at(variable).empty();
+    }
+    return feasible && propagate(csp);
+}
+
+
+long TableConstraint::value_index(size_t position, int value) const
+{
+    /**
+     * position of a value in the sorted supported values of a variable of the scope, or -1
+     */
+    const std::vector<int>& values = support_values[position];
+    auto found = std::lower_bound(values.begin(), values.end(), value);
+    return found != values.end() && *found == value ? found - values.begin() : -1;
+}
+
+
+const uint64_t* TableConstraint::support_words(size_t position, long value) const
+{
+    return supports[position].data() + static_cast<size_t>(value) * word_count;
+}
+
+
+bool TableConstraint::intersects_assigned(const CSP& csp, char variable, int value) const
+{
+    /**
+     * is there a tuple that agrees with variable=value and with every assigned variable of the scope
+     */
+    const size_t arity = scope.size();
+    for (size_t word = 0; word < word_count; word++)
+    {
+        uint64_t common = ~uint64_t{0};
+        for (size_t position = 0; position < arity && common != 0; position++)
+        {
+            int scope_value;
+            if (scope[position] == variable)
+            {
+                scope_value = value;
+            }
+            else
+            {
+                auto assigned = csp.assignment.find(scope[position]);
+                if (assigned == csp.assignment.end())
+                {
+                    continue;
+                }
+                scope_value = assigned->second;
+            }
+
+            long found = value_index(position, scope_value);
+            if (found < 0)
+            {
+                return false;
+            }
+            common &= support_words(position, found)[word];
+        }
+        if (common != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool TableConstraint::is_consistent(const CSP& csp, char variable, int value) const
+{
+    return intersects_assigned(csp, variable, value);
+}
+
+
+bool TableConstraint::holds(const CSP& csp) const
+{
+    return !scope.empty() && intersects_assigned(csp, scope[0], csp.assignment.at(scope[0]));
+}
+
+
+bool TableConstraint::propagate(CSP& csp) const
+{
+    /**
+     * Compact-Table: first intersect the valid tuples with the supports of what is left of every changed domain (an
+     * assigned variable counts as its single value), then remove the values whose supports no longer intersect them
+     */
+    const size_t arity = scope.size();
+    State current = state_of(csp);
+    uint64_t* words = current.words;
+    uint64_t* index = current.index;
+    uint64_t& limit = current.limit;
+    uint64_t* last_size = current.last_size;
+
+    ArenaFrame frame(csp.arena);
+    std::pmr::vector<uint64_t> mask(word_count, 0, &csp.arena);
+    for (size_t position = 0; position < arity; position++)
+    {
+        char variable = scope[position];
+        auto assigned = csp.assignment.find(variable);
+        const Domain& values = csp.domain.at(variable);
+        uint64_t size = assigned != csp.assignment.end() ? 1 : static_cast<uint64_t>(values.size());
+        if (size == last_size[position])
+        {
+            continue;
+        }
+        csp.save_word(last_size[position]);
+        last_size[position] = size;
+
+        std::fill(mask.begin(), mask.end(), 0);
+        if (assigned != csp.assignment.end())
+        {
+            long found = value_index(position, assigned->second);
+            if (found < 0)
+            {
+                return false;
+            }
+            const uint64_t* bits = support_words(position, found);
+            for (size_t word = 0; word < word_count; word++)
+            {
+                mask[word] = bits[word];
+            }
+        }
+        else
+        {
+            for (size_t value = 0; value < support_values[position].size(); value++)
+            {
+                if (values.contains(support_values[position][value]))
+                {
+                    const uint64_t* bits = support_words(position, static_cast<long>(value));
+                    for (size_t word = 0; word < word_count; word++)
+                    {
+                        mask[word] |= bits[word];
+                    }
+                }
+            }
+        }
+
+        for (size_t i = limit; i-- > 0;)
+        {
+            size_t word = index[i];
+            uint64_t kept = words[word] & mask[word];
+            if (kept != words[word])
+            {
+                csp.save_word(words[word]);
+                words[word] = kept;
+                if (kept == 0)
+                {
+                    // move the emptied word behind the limit; restoring the limit brings it back
+                    std::swap(index[i], index[limit - 1]);
+                    csp.save_word(limit);
+                    limit--;
+                }
+            }
+        }
+        if (limit == 0)
+        {
+            return false;
+        }
+    }
+
+    std::pmr::vector<int> unsupported(&csp.arena);
+    for (size_t position = 0; position < arity; position++)
+    {
+        char variable = scope[position];
+        if (csp.assignment.find(variable) != csp.assignment.end())
+        {
+            continue;
+        }
+
+        unsupported.clear();
+        Domain& values = csp.domain.at(variable);
+        for (int value: values)
+        {
+            long found = value_index(position, value);
+            if (found < 0)
+            {
+                unsupported.push_back(value);
+                continue;
+            }
+
+            const uint64_t* bits = support_words(position, found);
+            uint64_t& residue = current.residues[residue_offset[position] + static_cast<size_t>(found)];
+            if ((bits[residue] & words[residue]) != 0)
+            {
+                continue;
+            }
+            bool supported = false;
+            for (size_t i = 0; i < limit; i++)
+            {
+                if ((bits[index[i]] & words[index[i]]) != 0)
+                {
+                    residue = index[i];
+                    supported = true;
+                    break;
+                }
+            }
+            if (!supported)
+            {
+                unsupported.push_back(value);
+            }
+        }
+
+        if (!unsupported.empty())
+        {
+            csp.save_domain(variable);
+            for (int value: unsupported)
+            {
+                values.remove(value);
+            }
+            if (values.empty())
+            {
+                return false;
+            }
+            csp.save_word(last_size[position]);
+            last_size[position] = static_cast<uint64_t>(values.size());
+        }
+    }
+    return true;
+}
+
+
+std::string TableConstraint::describe() const
+{
+    std::string text = "table";
+    for (char variable: scope)
+    {
+        text += ' ';
+        text += variable;
+    }
+    return text + " (" + std::to_string(tuples.size()) + " tuples)";
+}
+
+
+size_t AllDifferent::prepare(std::unordered_map<char, Domain>&)
+{
+    return scope.size();
+}
+
+
+bool AllDifferent::initialize(CSP& csp) const
+{
+    uint64_t* matched_value = state(csp);
+    std::fill(matched_value, matched_value + scope.size(), static_cast<uint64_t>(static_cast<long long>(INT_MIN)));
+    return propagate(csp);
+}
+
+
+bool AllDifferent::is_consistent(const CSP& csp, char variable, int value) const
+{
+    for (char other_var: scope)
+    {
+        auto assigned = csp.assignment.find(other_var);
+        if (other_var != variable && assigned != csp.assignment.end() && assigned->second == value)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool AllDifferent::holds(const CSP& csp) const
+{
+    for (size_t i = 0; i < scope.size(); i++)
+    {
+        for (size_t j = i + 1; j < scope.size(); j++)
+        {
+            if (csp.assignment.at(scope[i]) == csp.assignment.at(scope[j]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+std::string TableConstraint::signature() const
+{
+    std::vector<std::vector<int>> sorted(tuples);
+    std::sort(sorted.begin(), sorted.end());
+    std::string text = "table";
+    for (const auto& tuple: sorted)
+    {
+        text += ';';
+        for (int value: tuple)
+        {
+            text += std::to_string(value) + ',';
+        }
+    }
+    return text;
+}
+
+
+std::string AllDifferent::signature() const
+{
+    return "alldiff";
+}
+
+
+std::string AllDifferent::describe() const
+{
+    std::string text = bounds_only ? "alldiff (bounds)" : "alldiff";
+    for (char variable: scope)
+    {
+        text += ' ';
+        text += variable;
+    }
+    return text;
+}
+
+
+bool AllDifferent::propagate(CSP& csp) const
+{
+    long long total = 0;
+    for (char variable: scope)
+    {
+        total += csp.assignment.count(variable) ? 1 : csp.domain.at(variable).size();
+    }
+    return bounds_only || total > max_matching_values ? propagate_bounds(csp) : propagate_matching(csp);
+}
+
+
+bool AllDifferent::propagate_matching(CSP& csp) const
+{
+    /**
+     * Régin's filtering. Find a maximum matching of the variables into the values; without one covering every
+     * variable the constraint fails. Then orient the value graph (matching edges variable -> value, the other edges
+     * value -> variable): an edge can be part of some maximum matching only if it is matched, lies on an alternating
+     * cycle (both ends in the same strongly connected component) or on an alternating path from a free value
+     * (its value is reachable from a free value). Every other value is removed
+     */
+    const size_t n = scope.size();
+    uint64_t* matched_value = state(csp);
+    ArenaFrame frame(csp.arena);
+    std::pmr::memory_resource* memory = &csp.arena;
+
+    // the effective domains: an assigned variable only has its value. The values are numbered in sorted order
+    std::pmr::vector<int> values(memory);
+    std::pmr::vector<size_t> first_edge(n + 1, 0, memory);
+    std::pmr::vector<int> edge_values(memory);
+    for (size_t x = 0; x < n; x++)
+    {
+        first_edge[x] = edge_values.size();
+        auto assigned = csp.assignment.find(scope[x]);
+        if (assigned != csp.assignment.end())
+        {
+            edge_values.push_back(assigned->second);
+        }
+        else
+        {
+            for (int value: csp.domain.at(scope[x]))
+            {
+                edge_values.push_back(value);
+            }
+        }
+    }
+    first_edge[n] = edge_values.size();
+    values.assign(edge_values.begin(), edge_values.end());
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    const size_t m = values.size();
+    if (m < n)
+    {
+        return false;
+    }
+
+    // edges as value numbers
+    std::pmr::vector<size_t> edges(edge_values.size(), 0, memory);
+    for (size_t e = 0; e < edges.size(); e++)
+    {
+        edges[e] = static_cast<size_t>(std::lower_bound(values.begin(), values.end(), edge_values[e]) - values.begin());
+    }
+
+    // maximum matching with augmenting paths (Kuhn), starting from the previous matching where it is still valid
+    const size_t none = SIZE_MAX;
+    std::pmr::vector<size_t> var_match(n, none, memory);
+    std::pmr::vector<size_t> value_match(m, none, memory);
+    for (size_t x = 0; x < n; x++)
+    {
+        for (size_t e = first_edge[x]; e < first_edge[x + 1]; e++)
+        {
+            if (values[edges[e]] == static_cast<long long>(matched_value[x]) && value_match[edges[e]] == none)
+            {
+                var_match[x] = edges[e];
+                value_match[edges[e]] = x;
+                break;
+            }
+        }
+    }
+
+    std::pmr::vector<size_t> visited(m, none, memory);
+    std::pmr::vector<std::pair<size_t, size_t>> stack(memory);
+    for (size_t root = 0; root < n; root++)
+    {
+        if (var_match[root] != none)
+        {
+            continue;
+        }
+        // depth first search for an augmenting path; stack holds (variable, next edge to try)
+        std::pmr::vector<size_t> path_values(memory);
+        stack.clear();
+        stack.emplace_back(root, first_edge[root]);
+        bool augmented = false;
+        while (!stack.empty() && !augmented)
+        {
+            auto& [x, e] = stack.back();
+            if (e == first_edge[x + 1])
+            {
+                stack.pop_back();
+                if (!path_values.empty())
+                {
+                    path_values.pop_back();
+                }
+                continue;
+            }
+            size_t v = edges[e++];
+            if (visited[v] == root)
+            {
+                continue;
+            }
+            visited[v] = root;
+            path_values.push_back(v);
+            if (value_match[v] == none)
+            {
+                augmented = true;
+            }
+            else
+            {
+                size_t next = value_match[v];
+                stack.emplace_back(next, first_edge[next]);
+            }
+        }
+        if (!augmented)
+        {
+            return false;
+        }
+        // flip the path: the k-th variable on the stack takes the k-th value
+        for (size_t k = 0; k < stack.size(); k++)
+        {
+            size_t x = stack[k].first;
+            size_t v = path_values[k];
+            var_match[x] = v;
+            value_match[v] = x;
+        }
+    }
+    for (size_t x = 0; x < n; x++)
+    {
+        matched_value[x] = static_cast<uint64_t>(static_cast<long long>(values[var_match[x]]));
+    }
+
+    // nodes 0..n-1 are the variables and n..n+m-1 the values. Mark what an alternating path from a free value reaches
+    std::pmr::vector<char> reached(n + m, 0, memory);
+    std::pmr::vector<std::pmr::vector<size_t>> value_edges(m, std::pmr::vector<size_t>(memory), memory);
+    for (size_t x = 0; x < n; x++)
+    {
+        for (size_t e = first_edge[x]; e < first_edge[x + 1]; e++)
+        {
+            if (edges[e] != var_match[x])
+            {
+                value_edges[edges[e]].push_back(x);
+            }
+        }
+    }
+    std::pmr::vector<size_t> queue(memory);
+    for (size_t v = 0; v < m; v++)
+    {
+        if (value_match[v] == none)
+        {
+            reached[n + v] = 1;
+            queue.push_back(n + v);
+        }
+    }
+    while (!queue.empty())
+    {
+        size_t node = queue.back();
+        queue.pop_back();
+        if (node >= n)
+        {
+            for (size_t x: value_edges[node - n])
+            {
+                if (!reached[x])
+                {
+                    reached[x] = 1;
+                    queue.push_back(x);
+                }
+            }
+        }
+        else if (!reached[n + var_match[node]])
+        {
+            reached[n + var_match[node]] = 1;
+            queue.push_back(n + var_match[node]);
+        }
+    }
+
+    // strongly connected components (iterative Tarjan) of the oriented graph
+    const size_t nodes = n + m;
+    std::pmr::vector<size_t> order(nodes, none, memory);
+    std::pmr::vector<size_t> low(nodes, 0, memory);
+    std::pmr::vector<size_t> component(nodes, none, memory);
+    std::pmr::vector<char> on_stack(nodes, 0, memory);
+    std::pmr::vector<size_t> tarjan_stack(memory);
+    std::pmr::vector<std::pair<size_t, size_t>> call_stack(memory);
+    size_t counter = 0;
+    size_t components = 0;
+    auto successor_count = [&](size_t node) {
+        return node < n ? size_t{1} : value_edges[node - n].size();
+    };
+    auto successor = [&](size_t node, size_t k) {
+        return node < n ? n + var_match[node] : value_edges[node - n][k];
+    };
+    for (size_t start = 0; start < nodes; start++)
+    {
+        if (order[start] != none)
+        {
+            continue;
+        }
+        call_stack.emplace_back(start, 0);
+        order[start] = low[start] = counter++;
+        tarjan_stack.push_back(start);
+        on_stack[start] = 1;
+        while (!call_stack.empty())
+        {
+            auto& [node, k] = call_stack.back();
+            if (k < successor_count(node))
+            {
+                size_t next = successor(node, k++);
+                if (order[next] == none)
+                {
+                    order[next] = low[next] = counter++;
+                    tarjan_stack.push_back(next);
+                    on_stack[next] = 1;
+                    call_stack.emplace_back(next, 0);
+                }
+                else if (on_stack[next])
+                {
+                    low[node] = std::min(low[node], order[next]);
+                }
+                continue;
+            }
+
+            size_t finished = node;
+            call_stack.pop_back();
+            if (!call_stack.empty())
+            {
+                size_t parent = call_stack.back().first;
+                low[parent] = std::min(low[parent], low[finished]);
+            }
+            if (low[finished] == order[finished])
+            {
+                size_t member;
+                do
+                {
+                    member = tarjan_stack.back();
+                    tarjan_stack.pop_back();
+                    on_stack[member] = 0;
+                    component[member] = components;
+                } while (member != finished);
+                components++;
+            }
+        }
+    }
+
+    // remove the values that belong to no maximum matching
+    std::pmr::vector<int> removed(memory);
+    for (size_t x = 0; x < n; x++)
+    {
+        char variable = scope[x];
+        if (csp.assignment.count(variable))
+        {
+            continue;
+        }
+        removed.clear();
+        for (size_t e = first_edge[x]; e < first_edge[x + 1]; e++)
+        {
+            size_t v = edges[e];
+            if (v != var_match[x] && !reached[n + v] && component[x] != component[n + v])
+            {
+                removed.push_back(values[v]);
+            }
+        }
+        if (!removed.empty())
+        {
+            csp.save_domain(variable);
+            for (int value: removed)
+            {
+                csp.domain.at(variable).remove(value);
+            }
+        }
+    }
+    return true;
+}
+
+
+bool AllDifferent::propagate_bounds(CSP& csp) const
+{
+    /**
+     * bounds consistency with Hall intervals: if k variables have their bounds inside an interval of k values, those
+     * values are taken and the other variables move their bounds out of the interval. More than k variables inside
+     * fails. The Hall intervals are found in O(n log n) by the algorithm of López-Ortiz, Quimper, Tromp and van Beek:
+     * the bounds are ranked once, one sweep in order of the upper bounds raises the lower bounds and one sweep in
+     * order of the lower bounds lowers the upper bounds, with the intervals merged as union-find paths. Repeated
+     * until the bounds no longer move
+     */
+    const size_t n = scope.size();
+    if (n < 2)
+    {
+        return true;
+    }
+    ArenaFrame frame(csp.arena);
+    std::pmr::memory_resource* memory = &csp.arena;
+    std::pmr::vector<long long> lo(n, 0, memory);
+    std::pmr::vector<long long> hi(n, 0, memory);
+    std::pmr::vector<size_t> min_rank(n, 0, memory);
+    std::pmr::vector<size_t> max_rank(n, 0, memory);
+    std::pmr::vector<size_t> by_min(n, 0, memory);
+    std::pmr::vector<size_t> by_max(n, 0, memory);
+    // the distinct values of lo and hi + 1, with a sentinel on either side
+    std::pmr::vector<long long> bounds(2 * n + 2, 0, memory);
+    // tree: union-find over the ranks; hall: the Hall intervals found so far; room: values left between two ranks
+    std::pmr::vector<size_t> tree(2 * n + 2, 0, memory);
+    std::pmr::vector<size_t> hall(2 * n + 2, 0, memory);
+    std::pmr::vector<long long> room(2 * n + 2, 0, memory);
+
+    auto path_max = [](const std::pmr::vector<size_t>& path, size_t i) {
+        while (path[i] > i)
+        {
+            i = path[i];
+        }
+        return i;
+    };
+    auto path_min = [](const std::pmr::vector<size_t>& path, size_t i) {
+        while (path[i] < i)
+        {
+            i = path[i];
+        }
+        return i;
+    };
+    auto path_set = [](std::pmr::vector<size_t>& path, size_t start, size_t end, size_t to) {
+        size_t next = start;
+        while (next != end)
+        {
+            size_t at = next;
+            next = path[at];
+            path[at] = to;
+        }
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t x = 0; x < n; x++)
+        {
+            auto assigned = csp.assignment.find(scope[x]);
+            const Domain& values = csp.domain.at(scope[x]);
+            if (assigned == csp.assignment.end() && values.empty())
+            {
+                return false;
+            }
+            lo[x] = assigned != csp.assignment.end() ? assigned->second : values.min();
+            hi[x] = assigned != csp.assignment.end() ? assigned->second : values.max();
+            by_min[x] = by_max[x] = x;
+        }
+        std::sort(by_min.begin(), by_min.end(), [&](size_t a, size_t b) { return lo[a] < lo[b]; });
+        std::sort(by_max.begin(), by_max.end(), [&](size_t a, size_t b) { return hi[a] < hi[b]; });
+
+        // rank lo and hi + 1 of every variable among the distinct bounds
+        size_t ranks = 0;
+        long long last = lo[by_min[0]] - 2;
+        bounds[0] = last;
+        for (size_t i = 0, j = 0; j < n;)
+        {
+            if (i < n && lo[by_min[i]] <= hi[by_max[j]] + 1)
+            {
+                if (lo[by_min[i]] != last)
+                {
+                    bounds[++ranks] = last = lo[by_min[i]];
+                }
+                min_rank[by_min[i++]] = ranks;
+            }
+            else
+            {
+                if (hi[by_max[j]] + 1 != last)
+                {
+                    bounds[++ranks] = last = hi[by_max[j]] + 1;
+                }
+                max_rank[by_max[j++]] = ranks;
+            }
+        }
+        bounds[ranks + 1] = bounds[ranks] + 2;
+
+        // raise the lower bounds, placing the variables in order of their upper bounds
+        std::pmr::vector<long long> new_lo(lo, memory);
+        for (size_t i = 1; i <= ranks + 1; i++)
+        {
+            tree[i] = hall[i] = i - 1;
+            room[i] = bounds[i] - bounds[i - 1];
+        }
+        for (size_t x: by_max)
+        {
+            size_t low = min_rank[x], high = max_rank[x];
+            size_t z = path_max(tree, low + 1);
+            size_t j = tree[z];
+            if (--room[z] == 0)
+            {
+                tree[z] = z + 1;
+                z = path_max(tree, tree[z]);
+                tree[z] = j;
+            }
+            path_set(tree, low + 1, z, z);
+            if (room[z] < bounds[z] - bounds[high])
+            {
+                return false;
+            }
+            if (hall[low] > low)
+            {
+                size_t w = path_max(hall, hall[low]);
+                new_lo[x] = bounds[w];
+                path_set(hall, low, w, w);
+            }
+            if (room[z] == bounds[z] - bounds[high])
+            {
+                path_set(hall, hall[high], j - 1, high);
+                hall[high] = j - 1;
+            }
+        }
+
+        // lower the upper bounds, placing the variables in reverse order of their lower bounds
+        std::pmr::vector<long long> new_hi(hi, memory);
+        for (size_t i = 0; i <= ranks; i++)
+        {
+            tree[i] = hall[i] = i + 1;
+            room[i] = bounds[i + 1] - bounds[i];
+        }
+        for (size_t k = n; k-- > 0;)
+        {
+            size_t x = by_min[k];
+            size_t high = max_rank[x], low = min_rank[x];
+            size_t z = path_min(tree, high - 1);
+            size_t j = tree[z];
+            if (--room[z] == 0)
+            {
+                tree[z] = z - 1;
+                z = path_min(tree, tree[z]);
+                tree[z] = j;
+            }
+            path_set(tree, high - 1, z, z);
+            if (room[z] < bounds[low] - bounds[z])
+            {
+                return false;
+            }
+            if (hall[high] < high)
+            {
+                size_t w = path_min(hall, hall[high]);
+                new_hi[x] = bounds[w] - 1;
+                path_set(hall, high, w, w);
+            }
+            if (room[z] == bounds[low] - bounds[z])
+            {
+                path_set(hall, hall[low], j + 1, low);
+                hall[low] = j + 1;
+            }
+        }
+
+        for (size_t x = 0; x < n; x++)
+        {
+            char variable = scope[x];
+            if ((new_lo[x] == lo[x] && new_hi[x] == hi[x]) || csp.assignment.count(variable))
+            {
+                continue;
+            }
+            if (new_lo[x] > new_hi[x])
+            {
+                return false;
+            }
+            if (csp.narrow_domain(variable, new_lo[x], new_hi[x]))
+            {
+                if (csp.domain.at(variable).empty())
+                {
+                    return false;
+                }
+                changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+
+LinearConstraint::LinearConstraint(std::vector<std::pair<char, long long>> terms, char op, long long right)
+        : op(op), right(right)
+{
+    for (const auto& term: terms)
+    {
+        position_of[static_cast<unsigned char>(term.first)] = static_cast<int>(scope.size());
+        scope.push_back(term.first);
+        coefs.push_back(term.second);
+    }
+    switch (op)
+    {
+        case '=': lower = upper = right; break;
+        case '<': upper = right - 1; break;
+        case 'L': upper = right; break;
+        case '>': lower = right + 1; break;
+        case 'G': lower = right; break;
+        default: break;
+    }
+}
+
+
+long long LinearConstraint::upper_limit(const CSP& csp) const
+{
+    if (bounded_by_incumbent && csp.objective_bound != LLONG_MAX)
+    {
+        return std::min(upper, csp.objective_bound - 1);
+    }
+    return upper;
+}
+
+
+void LinearConstraint::set_word(CSP& csp, size_t index, long long value) const
+{
+    if (word(csp, index) != value)
+    {
+        uint64_t& stored = state(csp)[index];
+        csp.save_word(stored);
+        stored = static_cast<uint64_t>(value);
+    }
+}
+
+
+std::pair<long long, long long> LinearConstraint::term_range(const CSP& csp, size_t position) const
+{
+    /**
+     * the smallest and largest value of coef * variable; an assigned variable counts as its value
+     */
+    auto assigned = csp.assignment.find(scope[position]);
+    const Domain& values = csp.domain.at(scope[position]);
+    if (assigned == csp.assignment.end() && values.empty())
+    {
+        return {0, 0};
+    }
+    long long lo = assigned != csp.assignment.end() ? assigned->second : values.min();
+    long long hi = assigned != csp.assignment.end() ? assigned->second : values.max();
+    return coefs[position] > 0 ? std::make_pair(coefs[position] * lo, coefs[position] * hi)
+                               : std::make_pair(coefs[position] * hi, coefs[position] * lo);
+}
+
+
+size_t LinearConstraint::prepare(std::unordered_map<char, Domain>& domains)
+{
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        const Domain& values = domains.at(scope[position]);
+        if (!values.empty())
+        {
+            widest_term = std::max(widest_term, std::abs(coefs[position]) * (static_cast<long long>(values.max()) -
+                                                                             values.min()));
+        }
+    }
+    return 2 + 2 * scope.size();
+}
+
+
+bool LinearConstraint::initialize(CSP& csp) const
+{
+    uint64_t* words = state(csp);
+    long long sum_min = 0;
+    long long sum_max = 0;
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        std::pair<long long, long long> range = term_range(csp, position);
+        words[2 + 2 * position] = static_cast<uint64_t>(range.first);
+        words[3 + 2 * position] = static_cast<uint64_t>(range.second);
+        sum_min += range.first;
+        sum_max += range.second;
+    }
+    words[0] = static_cast<uint64_t>(sum_min);
+    words[1] = static_cast<uint64_t>(sum_max);
+    return propagate(csp);
+}
+
+
+void LinearConstraint::notify(CSP& csp, char variable) const
+{
+    /**
+     * replace the old range of the variable's term in the sums by the new one
+     */
+    int position = position_of[static_cast<unsigned char>(variable)];
+    if (position < 0)
+    {
+        return;
+    }
+    std::pair<long long, long long> range = term_range(csp, static_cast<size_t>(position));
+    size_t term = 2 + 2 * static_cast<size_t>(position);
+    if (range.first == word(csp, term) && range.second == word(csp, term + 1))
+    {
+        return;
+    }
+    set_word(csp, 0, word(csp, 0) + range.first - word(csp, term));
+    set_word(csp, 1, word(csp, 1) + range.second - word(csp, term + 1));
+    set_word(csp, term, range.first);
+    set_word(csp, term + 1, range.second);
+}
+
+
+bool LinearConstraint::is_consistent(const CSP& csp, char variable, int value) const
+{
+    /**
+     * can the sum still reach the allowed range with variable = value, the other assigned variables at their values
+     * and the unassigned ones anywhere in their domains
+     */
+    long long sum_min = 0;
+    long long sum_max = 0;
+    bool fixed = true;
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        if (scope[position] == variable)
+        {
+            sum_min += coefs[position] * value;
+            sum_max += coefs[position] * value;
+            continue;
+        }
+        fixed = fixed && csp.assignment.count(scope[position]);
+        std::pair<long long, long long> range = term_range(csp, position);
+        sum_min += range.first;
+        sum_max += range.second;
+    }
+    if (op == '!')
+    {
+        return !fixed || sum_min != right;
+    }
+    return sum_min <= upper_limit(csp) && sum_max >= lower;
+}
+
+
+bool LinearConstraint::holds(const CSP& csp) const
+{
+    long long sum = 0;
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        sum += coefs[position] * csp.assignment.at(scope[position]);
+    }
+    return op == '!' ? sum != right : sum >= lower && sum <= upper_limit(csp);
+}
+
+
+bool LinearConstraint::propagate(CSP& csp) const
+{
+    /**
+     * with the other terms at their extremes, a term may only take the values that keep the sum in [lower, upper]:
+     *     coef * X <= upper - (sum_min - term_min)  and  coef * X >= lower - (sum_max - term_max)
+     * Narrowing a domain moves the sums, so this repeats until nothing changes
+     */
+    if (op == '!')
+    {
+        // only a fully fixed sum can violate it
+        return word(csp, 0) != word(csp, 1) || word(csp, 0) != right;
+    }
+
+    long long high = upper_limit(csp);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        long long sum_min = word(csp, 0);
+        long long sum_max = word(csp, 1);
+        if (sum_min > high || sum_max < lower)
+        {
+            return false;
+        }
+        if ((high == LLONG_MAX || high - sum_min >= widest_term) &&
+            (lower == LLONG_MIN || sum_max - lower >= widest_term))
+        {
+            return true;
+        }
+
+        for (size_t position = 0; position < scope.size(); position++)
+        {
+            char variable = scope[position];
+            if (csp.assignment.count(variable))
+            {
+                continue;
+            }
+            long long coef = coefs[position];
+            long long term_min = word(csp, 2 + 2 * position);
+            long long term_max = word(csp, 3 + 2 * position);
+            long long product_hi = high == LLONG_MAX ? LLONG_MAX : high - (word(csp, 0) - term_min);
+            long long product_lo = lower == LLONG_MIN ? LLONG_MIN : lower - (word(csp, 1) - term_max);
+            if (product_lo <= term_min && product_hi >= term_max)
+            {
+                continue;
+            }
+
+            long long lo = LLONG_MIN;
+            long long hi = LLONG_MAX;
+            if (coef > 0)
+            {
+                lo = product_lo == LLONG_MIN ? LLONG_MIN : ceil_div(product_lo, coef);
+                hi = product_hi == LLONG_MAX ? LLONG_MAX : floor_div(product_hi, coef);
+            }
+            else
+            {
+                lo = product_hi == LLONG_MAX ? LLONG_MIN : ceil_div(product_hi, coef);
+                hi = product_lo == LLONG_MIN ? LLONG_MAX : floor_div(product_lo, coef);
+            }
+            if (csp.narrow_domain(variable, lo, hi))
+            {
+                if (csp.domain.at(variable).empty())
+                {
+                    return false;
+                }
+                notify(csp, variable);
+                changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+
+std::string LinearConstraint::signature() const
+{
+    std::string text = std::string("linear ") + op + " " + std::to_string(right);
+    for (long long coef: coefs)
+    {
+        text += " " + std::to_string(coef);
+    }
+    return text;
+}
+
+
+std::string LinearConstraint::describe() const
+{
+    std::string text;
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        long long coef = coefs[position];
+        if (position > 0)
+        {
+            text += coef < 0 ? " - " : " + ";
+        }
+        else if (coef < 0)
+        {
+            text += "-";
+        }
+        if (coef != 1 && coef != -1)
+        {
+            text += std::to_string(coef < 0 ? -coef : coef) + "*";
+        }
+        text += scope[position];
+    }
+    return text + " " + operator_symbol(op) + " " + std::to_string(right);
+}
+
+
+Objective::Objective(std::vector<std::pair<char, long long>> terms, bool maximize, long long constant)
+        : LinearConstraint(std::move(terms), 0, 0), maximize(maximize), constant(constant)
+{
+    if (maximize)
+    {
+        for (long long& coef: coefs)
+        {
+            coef = -coef;
+        }
+    }
+    bounded_by_incumbent = true;
+}
+
+
+long long Objective::sum(const CSP& csp) const
+{
+    long long total = 0;
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        total += coefs[position] * csp.assignment.at(scope[position]);
+    }
+    return total;
+}
+
+
+long long Objective::value(const CSP& csp) const
+{
+    return (maximize ? -sum(csp) : sum(csp)) + constant;
+}
+
+
+std::string Objective::describe() const
+{
+    std::string text = maximize ? "maximize " : "minimize ";
+    for (size_t position = 0; position < scope.size(); position++)
+    {
+        long long coef = maximize ? -coefs[position] : coefs[position];
+        if (position > 0)
+        {
+            text += coef < 0 ? " - " : " + ";
+        }
+        else if (coef < 0)
+        {
+            text += "-";
+        }
+        if (coef != 1 && coef != -1)
+        {
+            text += std::to_string(coef < 0 ? -coef : coef) + "*";
+        }
+        text += scope[position];
+    }
+    if (constant != 0)
+    {
+        text += (constant < 0 ? " - " : " + ") + std::to_string(constant < 0 ? -constant : constant);
+    }
+    return text;
+}
+
+
+std::string Objective::signature() const
+{
+    std::string text = "objective";
+    for (long long coef: coefs)
+    {
+        text += " " + std::to_string(coef);
+    }
+    return text;
+}
+
+
+std::shared_ptr<const Model> build_model(std::unordered_map<char, Domain> variables,
+                                         const std::vector<Constraint>& constraints,
+                                         std::vector<std::unique_ptr<Propagator>> propagators)
+{
+    /**
+     * the model of a problem: the unary constraints are applied to the domains once here, so the search only ever
+     * sees binary constraints, and every n-ary constraint gets its share of the search state and filters the domains.
+     * What check_problem reports is worked around quietly: an undeclared variable gets an empty domain, a unary
+     * constraint on one is dropped, and so is every objective after the first
+     */
+    auto model = std::make_shared<Model>();
+    model->domain = std::move(variables);
+    model->propagators = std::move(propagators);
+    for (const auto& constraint: constraints)
+    {
+        if (!constraint.is_unary())
+        {
+            model->domain.try_emplace(constraint.var1);
+            model->domain.try_emplace(constraint.var2);
+            size_t index = model->constraints.size();
+            model->constraints.push_back(constraint);
+            model->constraints_of[constraint.var1].push_back(index);
+            if (constraint.var2 != constraint.var1)
+            {
+                model->constraints_of[constraint.var2].push_back(index);
+            }
+            continue;
+        }
+
+        auto found = model->domain.find(constraint.var1);
+        if (found == model->domain.end())
+        {
+            continue;
+        }
+        Constraint bound = constraint;
+        bound.coef = 0;
+        if (bound.op == '!')
+        {
+            long long excluded = 0;
+            bound.excluded_value(false, 0, excluded);
+            if (excluded >= INT_MIN && excluded <= INT_MAX)
+            {
+                found->second.remove(static_cast<int>(excluded));
+            }
+        }
+        else
+        {
+            std::pair<long long, long long> kept = bound.supports(false, 0, 0);
+            found->second.restrict(kept.first, kept.second);
+        }
+    }
+
+    // the first objective is the one optimized, the others are dropped
+    auto extra = std::remove_if(model->propagators.begin(), model->propagators.end(),
+                                [&](const std::unique_ptr<Propagator>& propagator) {
+        auto* objective = dynamic_cast<const Objective*>(propagator.get());
+        if (objective == nullptr)
+        {
+            return false;
+        }
+        if (model->objective == nullptr)
+        {
+            model->objective = objective;
+            return false;
+        }
+        return true;
+    });
+    model->propagators.erase(extra, model->propagators.end());
+
+    for (size_t index = 0; index < model->propagators.size(); index++)
+    {
+        for (char variable: model->propagators[index]->scope)
+        {
+            model->domain.try_emplace(variable);
+            model->propagators_of[variable].push_back(index);
+        }
+    }
+
+    // the initial filtering runs on a search of its own, whose domains and state become those of the model. It is
+    // not part of any search, so nothing of it has to be undone. After a wipeout the remaining constraints only get
+    // their share of the state
+    CSP setup(model, csp::Consistency::None);
+    for (const auto& propagator: model->propagators)
+    {
+        propagator->state_offset = setup.propagator_state.size();
+        setup.propagator_state.resize(propagator->state_offset + propagator->prepare(setup.domain));
+        // growing the state moves it, so nothing on the word trail may point into it
+        setup.word_trail.clear();
+        if (!model->infeasible && !propagator->initialize(setup))
+        {
+            model->infeasible = true;
+        }
+    }
+    model->domain = std::move(setup.domain);
+    model->propagator_state = std::move(setup.propagator_state);
+    return model;
+}
+
+
+std::vector<std::string> check_problem(const std::unordered_map<char, Domain>& variables,
+                                       const std::vector<Constraint>& constraints,
+                                       const std::vector<std::unique_ptr<Propagator>>& propagators)
+{
+    std::vector<std::string> errors;
+    auto check = [&](char variable) {
+        if (variables.find(variable) == variables.end())
+        {
+            errors.push_back(std::string("variable ") + variable + " of a constraint doesn't exist in the domain");
+        }
+    };
+    for (const auto& constraint: constraints)
+    {
+        check(constraint.var1);
+        if (!constraint.is_unary() && constraint.var2 != constraint.var1)
+        {
+            check(constraint.var2);
+        }
+    }
+    const Objective* objective = nullptr;
+    for (const auto& propagator: propagators)
+    {
+        for (char variable: propagator->scope)
+        {
+            check(variable);
+        }
+        if (auto* extra = dynamic_cast<const Objective*>(propagator.get()))
+        {
+            if (objective != nullptr)
+            {
+                errors.push_back("only one objective is allowed, '" + extra->describe() + "' is one too many");
+            }
+            objective = extra;
+        }
+    }
+    return errors;
+}
+
+
+std::vector<std::unique_ptr<Propagator>> detect_alldiff_cliques(std::vector<Constraint>& constraints)
+{
+    /**
+     * find groups of at least three variables that are pairwise connected by plain "X ! Y" constraints, replace each
+     * group's constraints by one all-different constraint and return those. The cliques are grown greedily, starting
+     * from the variables with the most '!' neighbours
+     */
+    auto is_difference = [](const Constraint& constraint) {
+        return constraint.op == '!' && !constraint.is_unary() && constraint.coef == 1 && constraint.offset == 0 &&
+               constraint.var1 != constraint.var2;
+    };
+
+    std::unordered_map<char, std::vector<char>> neighbours;
+    for (const auto& constraint: constraints)
+    {
+        if (is_difference(constraint))
+        {
+            neighbours[constraint.var1].push_back(constraint.var2);
+            neighbours[constraint.var2].push_back(constraint.var1);
+        }
+    }
+    auto adjacent = [&](char a, char b) {
+        const std::vector<char>& around = neighbours[a];
+        return std::find(around.begin(), around.end(), b) != around.end();
+    };
+
+    std::vector<char> candidates;
+    for (const auto& entry: neighbours)
+    {
+        candidates.push_back(entry.first);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](char a, char b) {
+        return neighbours[a].size() != neighbours[b].size() ? neighbours[a].size() > neighbours[b].size() : a < b;
+    });
+
+    // a pair already covered by a clique is not used for another one
+    std::vector<std::pair<char, char>> covered;
+    auto is_covered = [&](char a, char b) {
+        return std::find(covered.begin(), covered.end(), std::make_pair(std::min(a, b), std::max(a, b))) != covered.end();
+    };
+
+    std::vector<std::unique_ptr<Propagator>> cliques;
+    for (char start: candidates)
+    {
+        std::vector<char> clique{start};
+        for (char candidate: candidates)
+        {
+            bool joins = candidate != start;
+            for (char member: clique)
+            {
+                joins = joins && candidate != member && adjacent(candidate, member) && !is_covered(candidate, member);
+            }
+            if (joins)
+            {
+                clique.push_back(candidate);
+            }
+        }
+        if (clique.size() < 3)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < clique.size(); i++)
+        {
+            for (size_t j = i + 1; j < clique.size(); j++)
+            {
+                covered.emplace_back(std::min(clique[i], clique[j]), std::max(clique[i], clique[j]));
+            }
+        }
+        std::sort(clique.begin(), clique.end());
+        cliques.push_back(std::make_unique<AllDifferent>(std::move(clique)));
+    }
+
+    constraints.erase(std::remove_if(constraints.begin(), constraints.end(), [&](const Constraint& constraint) {
+        return is_difference(constraint) && is_covered(constraint.var1, constraint.var2);
+    }), constraints.end());
+    return cliques;
+}
+
+
+void add_alldiff_propagators(std::vector<Constraint>& constraints, std::vector<std::unique_ptr<Propagator>>& propagators,
+                             bool detect, bool bounds_only)
+{
+    if (detect)
+    {
+        for (auto& clique: detect_alldiff_cliques(constraints))
+        {
+            propagators.push_back(std::move(clique));
+        }
+    }
+    for (auto& propagator: propagators)
+    {
+        if (auto* alldiff = dynamic_cast<AllDifferent*>(propagator.get()))
+        {
+            alldiff->bounds_only = bounds_only;
+        }
+    }
+}
+
+
+/**
+ * the search is compiled for a combination of policies, so that nothing is decided per node at runtime.
+ * A propagation policy says what happens around an assignment that passed the consistency check, a variable order
+ * picks the variable to branch on and a value order lists the values to try for it
+ */
+struct NoPropagation {
+    // only domain splitting changes the domains, and it restores them itself
+    static constexpr bool changes_domains = false;
+
+    static bool before_assign(CSP&, char, int)
+    {
+        return true;
+    }
+
+    static bool after_assign(CSP&, char, size_t)
+    {
+        return true;
+    }
+};
+
+
+struct ForwardCheckingPropagation {
+    static constexpr bool changes_domains = true;
+
+    static bool before_assign(CSP& csp, char variable, int value)
+    {
+        return csp.forward_checking(variable, value);
+    }
+
+    // the n-ary constraints also propagate the new assignment; a wipeout there is a dead end just like one of
+    // forward checking
+    static bool after_assign(CSP& csp, char variable, size_t changed_from)
+    {
+        return csp.propagate_constraints(variable, changed_from);
+    }
+};
+
+
+// the variable with the fewest values left, ties broken by the most constraints on unassigned variables
+struct MostConstrainedVariable {
+    static char select(const CSP& csp)
+    {
+        return csp.select_variable();
+    }
+};
+
+
+// the values that leave the most values to the neighbours first
+struct LeastConstrainingValue {
+    static std::pmr::vector<int> order(const CSP& csp, char variable)
+    {
+        return csp.select_values(variable);
+    }
+};
+
+
+// warm start: the value the variable had in a previous solution first, then the others by least constraining value
+struct SolutionGuidedValue {
+    static std::pmr::vector<int> order(const CSP& csp, char variable)
+    {
+        std::pmr::vector<int> values = csp.select_values(variable);
+        auto hint = csp.preferred_values.find(variable);
+        if (hint != csp.preferred_values.end())
+        {
+            auto found = std::find(values.begin(), values.end(), hint->second);
+            std::rotate(values.begin(), found, found == values.end() ? found : found + 1);
+        }
+        return values;
+    }
+};
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+SearchResult recursive_backtrack_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp);
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+SearchResult split_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp, char variable) {
+    /**
+     * domain splitting (bisection) for a variable with too many values to enumerate: search with its domain cut down
+     * to the lower half, then to the upper half. After the cut the bounds are propagated through the constraints so
+     * the neighbours shrink with it. The variable stays unassigned and is picked again until its domain is small
+     */
+    long long lo = csp.get_domain_min(variable);
+    long long middle = lo + (static_cast<long long>(csp.get_domain_max(variable)) - lo) / 2;
+
+    csp.tree_estimate.enter(2);
+    for (bool lower_half : {true, false}) {
+        CSP::TrailMark domain_mark = csp.trail_mark();
+        if (csp.split_domain(variable, middle, lower_half) && csp.propagate_bounds(variable) &&
+            csp.propagate_constraints(variable, domain_mark.domains)) {
+            SearchResult below = recursive_backtrack_search<Propagation, VariableOrder, ValueOrder>(
+                    i, order_vars_assigned, csp);
+            if (below == SearchResult::Found) {
+                csp.tree_estimate.leave();
+                return below;
+            }
+            if (below == SearchResult::Stopped) {
+                csp.restore_domain(domain_mark);
+                csp.tree_estimate.leave();
+                return below;
+            }
+        }
+        else {
+            csp.tree_estimate.leaf();
+        }
+        csp.restore_domain(domain_mark);
+    }
+    csp.tree_estimate.leave();
+    return SearchResult::Exhausted;
+}
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+SearchResult recursive_backtrack_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp) {
+    // the scratch data of this node is given back when it returns
+    ArenaFrame frame(csp.arena);
+
+    // Here we check if the assignment is complete
+    if (csp.is_complete_assignment() && csp.is_solution()) {
+        // we need to print variables in order
+        i++;
+        csp.stats.solutions++;
+        csp.tree_estimate.leaf();
+        if (csp.stats.solutions == 1)
+        {
+            csp.solution_order = order_vars_assigned;
+        }
+        if (!csp.quiet)
+        {
+            csp.print_success(order_vars_assigned, i);
+        }
+        if (csp.on_solution)
+        {
+            return csp.on_solution(order_vars_assigned) ? SearchResult::Exhausted : SearchResult::Found;
+        }
+        // when counting, go on as if this were a dead end
+        return csp.count_all ? SearchResult::Exhausted : SearchResult::Found;
+    }
+
+    // select the next variable from the domain based on un-assigned variables and the current domain
+    int depth = static_cast<int>(order_vars_assigned.size());
+    char variable = VariableOrder::select(csp);
+    if (variable == 0) {
+        // variables are left but none of them has a value to try
+        csp.tree_estimate.leaf();
+        return SearchResult::Exhausted;
+    }
+    csp.stats.count_node(depth);
+    csp.poll_progress(depth);
+    csp.sample_trace_counters(depth);
+    if (csp.limit_reached()) {
+        // nothing was changed at this node yet; the nodes above undo their own changes on the way up
+        csp.tree_estimate.leaf();
+        return SearchResult::Stopped;
+    }
+
+    // a domain too large to enumerate is split in two instead of being branched on value by value
+    if (csp.get_domain_count(variable) > csp.split_threshold) {
+        return split_search<Propagation, VariableOrder, ValueOrder>(i, order_vars_assigned, csp, variable);
+    }
+    order_vars_assigned.push_back(variable);
+
+    // create value selection vector based on the least constraining value heuristic
+    std::pmr::vector<int> values_least_cnst_hstc = ValueOrder::order(csp, variable);
+    csp.tree_estimate.enter(static_cast<int>(values_least_cnst_hstc.size()));
+    for (int value : values_least_cnst_hstc) {
+        // a variable and a value was available in the domain
+        // does the new variable=value assignment pass all the constraints...?
+        csp.stats.consistency_checks++;
+        if (csp.is_consistent(variable, value)) {
+
+            // ... YES it does so let's continue searching
+
+            // if we are performing forward checking then see if we reach a dead end or not
+            // the forward checking function should only update the domain if it does not lead to a dead end
+            // if it returns true it means we can continue with our search...POGGERS
+            // if it returns false we cannot continue this search ... :((
+            CSP::TrailMark domain_mark = csp.trail_mark();
+
+            if (Propagation::changes_domains) {
+                if (!Propagation::before_assign(csp, variable, value))
+                {
+                    csp.stats.fc_wipeouts++;
+                    csp.tree_estimate.leaf();
+                    // ... we can't continue the search
+                    // un-assign the value from the variable and move on
+                    // the domain has remained the same
+                    continue;
+                }
+            }
+
+            // assign the variable=value in our current assignment
+            csp.assign_variable(variable, value);
+
+            // with forward checking the n-ary constraints also propagate the new assignment; a wipeout there is a dead
+            // end just like one of forward checking
+            if (!Propagation::after_assign(csp, variable, domain_mark.domains))
+            {
+                csp.restore_domain(domain_mark);
+                csp.un_assign_variable(variable);
+                csp.stats.fc_wipeouts++;
+                csp.tree_estimate.leaf();
+                continue;
+            }
+
+            // at this point we know for sure we can have one more branch in the search tree
+            // so increment the i
+
+            SearchResult below = recursive_backtrack_search<Propagation, VariableOrder, ValueOrder>(
+                    i, order_vars_assigned, csp);
+            if (below == SearchResult::Found) {
+                csp.tree_estimate.leave();
+                return below;
+            }
+
+            if (Propagation::changes_domains)
+            {
+                // restore the domain first
+                csp.restore_domain(domain_mark);
+            }
+
+            // un-assign the variable
+            csp.un_assign_variable(variable);
+            if (below == SearchResult::Stopped) {
+                csp.tree_estimate.leave();
+                order_vars_assigned.pop_back();
+                return below;
+            }
+            csp.stats.backtracks++;
+        }
+        else{
+            // we can print assignment here + the value that was just chosen
+            // we need to print variables in order
+            i++;
+            csp.stats.count_failure(depth);
+            csp.tree_estimate.leaf();
+            if (!csp.quiet)
+            {
+                csp.print_failure(order_vars_assigned, i, value);
+            }
+        }
+
+    }
+    // at this point we reached a failure. We can print it
+    csp.tree_estimate.leave();
+    order_vars_assigned.pop_back();
+    return SearchResult::Exhausted;
+}
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+Generator<std::vector<char>> solution_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp);
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+Generator<std::vector<char>> split_solutions(int& i, std::vector<char>& order_vars_assigned, CSP& csp, char variable) {
+    /**
+     * split_search as a coroutine: the solutions of both halves are passed up as they are found
+     */
+    long long lo = csp.get_domain_min(variable);
+    long long middle = lo + (static_cast<long long>(csp.get_domain_max(variable)) - lo) / 2;
+
+    csp.tree_estimate.enter(2);
+    for (bool lower_half : {true, false}) {
+        CSP::TrailMark domain_mark = csp.trail_mark();
+        if (csp.split_domain(variable, middle, lower_half) && csp.propagate_bounds(variable) &&
+            csp.propagate_constraints(variable, domain_mark.domains)) {
+            auto half = solution_search<Propagation, VariableOrder, ValueOrder>(i, order_vars_assigned, csp);
+            while (half.next()) {
+                co_yield half.value();
+            }
+        }
+        else {
+            csp.tree_estimate.leaf();
+        }
+        csp.restore_domain(domain_mark);
+        if (csp.stopped()) {
+            break;
+        }
+    }
+    csp.tree_estimate.leave();
+}
+
+
+template <typename Propagation, typename VariableOrder, typename ValueOrder>
+Generator<std::vector<char>> solution_search(int& i, std::vector<char>& order_vars_assigned, CSP& csp) {
+    /**
+     * recursive_backtrack_search as a coroutine: a solution is yielded instead of ending the search, and the next
+     * resume backtracks from it. Every node keeps its value order and trail mark in its suspended frame
+     */
+    ArenaFrame frame(csp.arena);
+
+    if (csp.is_complete_assignment() && csp.is_solution()) {
+        i++;
+        csp.stats.solutions++;
+        csp.tree_estimate.leaf();
+        if (csp.stats.solutions == 1)
+        {
+            csp.solution_order = order_vars_assigned;
+        }
+        if (!csp.quiet)
+        {
+            csp.print_success(order_vars_assigned, i);
+        }
+        co_yield order_vars_assigned;
+        co_return;
+    }
+
+    int depth = static_cast<int>(order_vars_assigned.size());
+    char variable = VariableOrder::select(csp);
+    if (variable == 0) {
+        csp.tree_estimate.leaf();
+        co_return;
+    }
+    csp.stats.count_node(depth);
+    csp.poll_progress(depth);
+    csp.sample_trace_counters(depth);
+    if (csp.limit_reached()) {
+        csp.tree_estimate.leaf();
+        co_return;
+    }
+
+    if (csp.get_domain_count(variable) > csp.split_threshold) {
+        auto halves = split_solutions<Propagation, VariableOrder, ValueOrder>(i, order_vars_assigned, csp, variable);
+        while (halves.next()) {
+            co_yield halves.value();
+        }
+        co_return;
+    }
+    order_vars_assigned.push_back(variable);
+
+    std::pmr::vector<int> values = ValueOrder::order(csp, variable);
+    csp.tree_estimate.enter(static_cast<int>(values.size()));
+    for (int value : values) {
+        csp.stats.consistency_checks++;
+        if (!csp.is_consistent(variable, value)) {
+            i++;
+            csp.stats.count_failure(depth);
+            csp.tree_estimate.leaf();
+            if (!csp.quiet)
+            {
+                csp.print_failure(order_vars_assigned, i, value);
+            }
+            continue;
+        }
+
+        CSP::TrailMark domain_mark = csp.trail_mark();
+        if (Propagation::changes_domains && !Propagation::before_assign(csp, variable, value)) {
+            csp.stats.fc_wipeouts++;
+            csp.tree_estimate.leaf();
+            continue;
+        }
+        csp.assign_variable(variable, value);
+        if (!Propagation::after_assign(csp, variable, domain_mark.domains))
+        {
+            csp.restore_domain(domain_mark);
+            csp.un_assign_variable(variable);
+            csp.stats.fc_wipeouts++;
+            csp.tree_estimate.leaf();
+            continue;
+        }
+
+        auto below = solution_search<Propagation, VariableOrder, ValueOrder>(i, order_vars_assigned, csp);
+        while (below.next()) {
+            co_yield below.value();
+        }
+
+        if (Propagation::changes_domains)
+        {
+            csp.restore_domain(domain_mark);
+        }
+        csp.un_assign_variable(variable);
+        if (csp.stopped()) {
+            // a limit ended the search below: unwind without trying the other values
+            break;
+        }
+        csp.stats.backtracks++;
+    }
+    csp.tree_estimate.leave();
+    order_vars_assigned.pop_back();
+}
+
+
+/**
+ * the solution counts of components, for counting with component caching. When the entries take more than the limit,
+ * the half of them that was used least recently is evicted
+ */
+class ComponentCache {
+public:
+    long long evictions = 0;
+
+    explicit ComponentCache(size_t limit_bytes) : limit_bytes(limit_bytes)
+    {
+    }
+
+
+    bool lookup(const std::string& key, unsigned long long& count)
+    {
+        auto found = entries.find(key);
+        if (found == entries.end())
+        {
+            return false;
+        }
+        found->second.last_use = ++clock;
+        count = found->second.count;
+        return true;
+    }
+
+
+    void store(const std::string& key, unsigned long long count)
+    {
+        if (entries.emplace(key, Entry{count, ++clock}).second)
+        {
+            bytes += key.size() + entry_overhead;
+        }
+        if (bytes > limit_bytes)
+        {
+            evict();
+        }
+    }
+
+private:
+    struct Entry {
+        unsigned long long count;
+        unsigned long long last_use;
+    };
+    // rough size of an entry of the hash table besides its key
+    static constexpr size_t entry_overhead = 64;
+
+    std::unordered_map<std::string, Entry> entries;
+    size_t limit_bytes;
+    size_t bytes = 0;
+    unsigned long long clock = 0;
+
+
+    void evict()
+    {
+        std::vector<unsigned long long> uses;
+        uses.reserve(entries.size());
+        for (const auto& entry: entries)
+        {
+            uses.push_back(entry.second.last_use);
+        }
+        auto middle = uses.begin() + static_cast<std::ptrdiff_t>(uses.size() / 2);
+        std::nth_element(uses.begin(), middle, uses.end());
+        unsigned long long oldest_kept = *middle;
+
+        for (auto entry = entries.begin(); entry != entries.end();)
+        {
+            if (entry->second.last_use < oldest_kept)
+            {
+                bytes -= entry->first.size() + entry_overhead;
+                entry = entries.erase(entry);
+                evictions++;
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+    }
+};
+
+
+std::vector<std::vector<char>> residual_components(const CSP& csp, const std::vector<char>& variables)
+{
+    /**
+     * split unassigned variables into the groups that are connected through constraints among them
+     */
+    std::vector<char> parent(256, 0);
+    std::vector<char> member(256, 0);
+    for (char variable: variables)
+    {
+        parent[static_cast<unsigned char>(variable)] = variable;
+        member[static_cast<unsigned char>(variable)] = 1;
+    }
+    std::function<char(char)> root = [&](char variable) {
+        char& up = parent[static_cast<unsigned char>(variable)];
+        if (up != variable)
+        {
+            up = root(up);
+        }
+        return up;
+    };
+    auto join = [&](char a, char b) {
+        a = root(a);
+        b = root(b);
+        parent[static_cast<unsigned char>(std::max(a, b))] = std::min(a, b);
+    };
+
+    for (const auto& constraint: csp.constraints)
+    {
+        if (member[static_cast<unsigned char>(constraint.var1)] && member[static_cast<unsigned char>(constraint.var2)])
+        {
+            join(constraint.var1, constraint.var2);
+        }
+    }
+    for (const auto& propagator: csp.propagators)
+    {
+        char first = 0;
+        for (char variable: propagator->scope)
+        {
+            if (member[static_cast<unsigned char>(variable)])
+            {
+                first = first == 0 ? variable : first;
+                join(first, variable);
+            }
+        }
+    }
+
+    std::vector<std::vector<char>> components;
+    std::vector<int> component_of(256, -1);
+    for (char variable: variables)
+    {
+        unsigned char top = static_cast<unsigned char>(root(variable));
+        if (component_of[top] < 0)
+        {
+            component_of[top] = static_cast<int>(components.size());
+            components.emplace_back();
+        }
+        components[component_of[top]].push_back(variable);
+    }
+    return components;
+}
+
+
+std::string component_key(const CSP& csp, const std::vector<char>& component)
+{
+    /**
+     * the count of a component depends only on the current domains of its variables and on the values of the assigned
+     * variables that share a constraint with them, so those make up its key
+     */
+    std::vector<char> member(256, 0);
+    std::vector<char> sorted(component);
+    std::sort(sorted.begin(), sorted.end());
+    for (char variable: sorted)
+    {
+        member[static_cast<unsigned char>(variable)] = 1;
+    }
+
+    std::string key;
+    auto append_int = [&](int value) {
+        char bytes[sizeof(int)];
+        std::memcpy(bytes, &value, sizeof(int));
+        key.append(bytes, sizeof(int));
+    };
+    for (char variable: sorted)
+    {
+        key.push_back(variable);
+        const std::vector<Domain::Interval>& intervals = csp.domain.at(variable).get_intervals();
+        append_int(static_cast<int>(intervals.size()));
+        for (const auto& interval: intervals)
+        {
+            append_int(interval.lo);
+            append_int(interval.hi);
+        }
+    }
+
+    std::vector<char> neighbours;
+    auto add_assigned = [&](char variable) {
+        if (csp.assignment.count(variable))
+        {
+            neighbours.push_back(variable);
+        }
+    };
+    for (const auto& constraint: csp.constraints)
+    {
+        if (member[static_cast<unsigned char>(constraint.var1)])
+        {
+            add_assigned(constraint.var2);
+        }
+        else if (member[static_cast<unsigned char>(constraint.var2)])
+        {
+            add_assigned(constraint.var1);
+        }
+    }
+    for (const auto& propagator: csp.propagators)
+    {
+        if (std::any_of(propagator->scope.begin(), propagator->scope.end(), [&](char variable) {
+            return member[static_cast<unsigned char>(variable)] != 0;
+        }))
+        {
+            std::for_each(propagator->scope.begin(), propagator->scope.end(), add_assigned);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    key.push_back(0);
+    for (char variable: neighbours)
+    {
+        key.push_back(variable);
+        append_int(csp.assignment.at(variable));
+    }
+    return key;
+}
+
+
+template <typename Propagation>
+unsigned long long count_component(CSP& csp, ComponentCache& cache, const std::vector<char>& component, int depth);
+
+
+template <typename Propagation>
+unsigned long long count_components(CSP& csp, ComponentCache& cache, const std::vector<char>& variables, int depth)
+{
+    /**
+     * the number of solutions of unassigned variables is the product of the counts of their components
+     */
+    unsigned long long product = 1;
+    for (const auto& component: residual_components(csp, variables))
+    {
+        product *= count_component<Propagation>(csp, cache, component, depth);
+        if (product == 0 || csp.stopped())
+        {
+            break;
+        }
+    }
+    return product;
+}
+
+
+template <typename Propagation>
+unsigned long long count_component(CSP& csp, ComponentCache& cache, const std::vector<char>& component, int depth)
+{
+    /**
+     * count the solutions of a connected component (modulo 2^64): branch on its variable with the fewest values,
+     * and after every assignment count the components the rest falls apart into. Counts are cached by component_key.
+     * When a limit stops the search the count so far is returned, and neither it nor any count above it is cached
+     */
+    if (component.empty())
+    {
+        return 1;
+    }
+    std::string key = component_key(csp, component);
+    unsigned long long total = 0;
+    if (cache.lookup(key, total))
+    {
+        csp.stats.cache_hits++;
+        return total;
+    }
+    csp.stats.cache_misses++;
+
+    char variable = component.front();
+    for (char candidate: component)
+    {
+        long long size = csp.get_domain_count(candidate);
+        long long best = csp.get_domain_count(variable);
+        if (size < best || (size == best && candidate < variable))
+        {
+            variable = candidate;
+        }
+    }
+    csp.stats.count_node(depth);
+    csp.poll_progress(depth);
+    if (csp.limit_reached())
+    {
+        return 0;
+    }
+
+    if (csp.get_domain_count(variable) > csp.split_threshold)
+    {
+        // too many values to enumerate: count the two halves of the domain
+        long long lo = csp.get_domain_min(variable);
+        long long middle = lo + (static_cast<long long>(csp.get_domain_max(variable)) - lo) / 2;
+        for (bool lower_half : {true, false})
+        {
+            CSP::TrailMark domain_mark = csp.trail_mark();
+            if (csp.split_domain(variable, middle, lower_half) && csp.propagate_bounds(variable) &&
+                csp.propagate_constraints(variable, domain_mark.domains))
+            {
+                total += count_components<Propagation>(csp, cache, component, depth + 1);
+            }
+            csp.restore_domain(domain_mark);
+            if (csp.stopped())
+            {
+                return total;
+            }
+        }
+        cache.store(key, total);
+        return total;
+    }
+
+    std::vector<char> rest;
+    for (char other: component)
+    {
+        if (other != variable)
+        {
+            rest.push_back(other);
+        }
+    }
+    const Domain& values = csp.domain.at(variable);
+    std::vector<int> candidates(values.begin(), values.end());
+    for (int value: candidates)
+    {
+        csp.stats.consistency_checks++;
+        if (!csp.is_consistent(variable, value))
+        {
+            csp.stats.count_failure(depth);
+            continue;
+        }
+        CSP::TrailMark domain_mark = csp.trail_mark();
+        if (!Propagation::before_assign(csp, variable, value))
+        {
+            csp.stats.fc_wipeouts++;
+            continue;
+        }
+        csp.assign_variable(variable, value);
+        if (!Propagation::after_assign(csp, variable, domain_mark.domains))
+        {
+            csp.stats.fc_wipeouts++;
+        }
+        else
+        {
+            total += count_components<Propagation>(csp, cache, rest, depth + 1);
+            csp.stats.backtracks++;
+        }
+        csp.restore_domain(domain_mark);
+        csp.un_assign_variable(variable);
+        if (csp.stopped())
+        {
+            return total;
+        }
+    }
+    cache.store(key, total);
+    return total;
+}
+
+
+bool backtrack_search(CSP& csp) {
+    TraceSpan span("search");
+    csp.stats.start_search();
+    if (csp.model->infeasible)
+    {
+        return false;
+    }
+    if (csp.count_all && csp.cache_limit_bytes > 0)
+    {
+        ComponentCache cache(csp.cache_limit_bytes);
+        // a variable with an empty domain counts too, it makes the count 0
+        std::vector<char> unassigned;
+        for (const auto& variable: csp.domain)
+        {
+            if (!csp.assignment.count(variable.first))
+            {
+                unassigned.push_back(variable.first);
+            }
+        }
+        std::sort(unassigned.begin(), unassigned.end());
+        unsigned long long count = csp.consistency == csp::Consistency::ForwardChecking
+                ? count_components<ForwardCheckingPropagation>(csp, cache, unassigned, 0)
+                : count_components<NoPropagation>(csp, cache, unassigned, 0);
+        csp.stats.solutions = static_cast<long long>(count);
+        csp.stats.cache_evictions = cache.evictions;
+        return csp.stats.solutions != 0;
+    }
+    std::vector<char> order_vars_assigned;
+    int i = 0;
+    search_for_mode(csp.consistency, !csp.preferred_values.empty())(i, order_vars_assigned, csp);
+    return csp.stats.solutions > 0;
+}
+
+
+bool branch_and_bound(CSP& csp, const std::function<bool(const std::vector<char>&)>& on_improvement)
+{
+    /**
+     * the search goes on past every solution; the objective, a linear constraint bounded by csp.objective_bound,
+     * makes the next one better than it, and prunes with the smallest sum the current domains still allow
+     */
+    csp.on_solution = [&](const std::vector<char>& order) {
+        csp.objective_bound = csp.objective->sum(csp);
+        return !on_improvement || on_improvement(order);
+    };
+    backtrack_search(csp);
+    csp.on_solution = nullptr;
+    return csp.stats.solutions > 0;
+}
+
+
+SearchFunction search_for_mode(csp::Consistency consistency, bool guided)
+{
+    /**
+     * the search compiled for a level of consistency, with the value order of a warm start if guided
+     */
+    if (consistency == csp::Consistency::ForwardChecking)
+    {
+        return guided ? recursive_backtrack_search<ForwardCheckingPropagation, MostConstrainedVariable,
+                                                   SolutionGuidedValue>
+                      : recursive_backtrack_search<ForwardCheckingPropagation, MostConstrainedVariable,
+                                                   LeastConstrainingValue>;
+    }
+    return guided ? recursive_backtrack_search<NoPropagation, MostConstrainedVariable, SolutionGuidedValue>
+                  : recursive_backtrack_search<NoPropagation, MostConstrainedVariable, LeastConstrainingValue>;
+}
+
+
+Generator<std::vector<char>> generate_solutions(CSP& csp)
+{
+    csp.stats.start_search();
+    if (csp.model->infeasible)
+    {
+        co_return;
+    }
+    std::vector<char> order_vars_assigned;
+    int i = 0;
+    auto solutions = csp.consistency == csp::Consistency::ForwardChecking
+            ? solution_search<ForwardCheckingPropagation, MostConstrainedVariable, LeastConstrainingValue>(
+                    i, order_vars_assigned, csp)
+            : solution_search<NoPropagation, MostConstrainedVariable, LeastConstrainingValue>(
+                    i, order_vars_assigned, csp);
+    while (solutions.next())
+    {
+        co_yield solutions.value();
+    }
+}
+
+
+std::vector<std::vector<char>> connected_components(const std::unordered_map<char, Domain>& variables,
+                                                    const std::vector<Constraint>& constraints,
+                                                    const std::vector<std::unique_ptr<Propagator>>& propagators)
+{
+    /**
+     * the connected components of the constraint graph: two variables are connected when a constraint involves both.
+     * Each component is sorted, and the components are ordered by their first variable
+     */
+    std::vector<char> parent(256);
+    for (size_t c = 0; c < parent.size(); c++)
+    {
+        parent[c] = static_cast<char>(c);
+    }
+    std::function<char(char)> root = [&](char variable) {
+        char& up = parent[static_cast<unsigned char>(variable)];
+        if (up != variable)
+        {
+            up = root(up);
+        }
+        return up;
+    };
+    auto join = [&](char a, char b) {
+        a = root(a);
+        b = root(b);
+        parent[static_cast<unsigned char>(std::max(a, b))] = std::min(a, b);
+    };
+
+    std::vector<char> present(256, 0);
+    for (const auto& entry: variables)
+    {
+        present[static_cast<unsigned char>(entry.first)] = 1;
+    }
+    for (const auto& constraint: constraints)
+    {
+        present[static_cast<unsigned char>(constraint.var1)] = 1;
+        if (!constraint.is_unary())
+        {
+            present[static_cast<unsigned char>(constraint.var2)] = 1;
+            join(constraint.var1, constraint.var2);
+        }
+    }
+    for (const auto& propagator: propagators)
+    {
+        for (char variable: propagator->scope)
+        {
+            present[static_cast<unsigned char>(variable)] = 1;
+            join(variable, propagator->scope.front());
+        }
+    }
+
+    std::vector<std::vector<char>> components;
+    std::vector<int> component_of(256, -1);
+    for (size_t c = 0; c < present.size(); c++)
+    {
+        if (!present[c])
+        {
+            continue;
+        }
+        unsigned char top = static_cast<unsigned char>(root(static_cast<char>(c)));
+        if (component_of[top] < 0)
+        {
+            component_of[top] = static_cast<int>(components.size());
+            components.emplace_back();
+        }
+        components[component_of[top]].push_back(static_cast<char>(c));
+    }
+    return components;
+}
+
+
+void solve_components(std::unordered_map<char, Domain>& variables, std::vector<Constraint>& constraints,
+                      std::vector<std::unique_ptr<Propagator>>& propagators,
+                      const std::vector<std::vector<char>>& components, csp::Consistency consistency, int threads,
+                      const std::function<void(CSP&)>& configure, bool print_stats)
+{
+    /**
+     * search every component on its own, on up to threads threads, and combine the results: one solution is the
+     * solutions of all components side by side (numbered with the branches of all searches together), and the number
+     * of solutions is the product of the counts of the components. The traces of the searches are not printed
+     */
+    std::vector<int> component_of(256, 0);
+    for (size_t k = 0; k < components.size(); k++)
+    {
+        for (char variable: components[k])
+        {
+            component_of[static_cast<unsigned char>(variable)] = static_cast<int>(k);
+        }
+    }
+
+    std::vector<std::unordered_map<char, Domain>> component_variables(components.size());
+    std::vector<std::vector<Constraint>> component_constraints(components.size());
+    std::vector<std::vector<std::unique_ptr<Propagator>>> component_propagators(components.size());
+    for (auto& entry: variables)
+    {
+        component_variables[component_of[static_cast<unsigned char>(entry.first)]][entry.first] = std::move(entry.second);
+    }
+    for (const auto& constraint: constraints)
+    {
+        component_constraints[component_of[static_cast<unsigned char>(constraint.var1)]].push_back(constraint);
+    }
+    for (auto& propagator: propagators)
+    {
+        int k = propagator->scope.empty() ? 0 : component_of[static_cast<unsigned char>(propagator->scope.front())];
+        component_propagators[k].push_back(std::move(propagator));
+    }
+
+    std::vector<std::unique_ptr<CSP>> searches(components.size());
+    std::atomic<size_t> next_component{0};
+    auto work = [&]() {
+        for (size_t k = next_component++; k < components.size(); k = next_component++)
+        {
+            searches[k] = std::make_unique<CSP>(std::move(component_variables[k]), std::move(component_constraints[k]),
+                                                consistency, std::move(component_propagators[k]));
+            configure(*searches[k]);
+            searches[k]->quiet = true;
+            backtrack_search(*searches[k]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < std::min<int>(threads, static_cast<int>(components.size())); t++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker: workers)
+    {
+        worker.join();
+    }
+
+    bool solved = true;
+    bool stopped = false;
+    unsigned long long count = 1;
+    long long branches = 0;
+    for (const auto& search: searches)
+    {
+        solved = solved && search->stats.solutions > 0;
+        stopped = stopped || search->stopped();
+        count *= static_cast<unsigned long long>(search->stats.solutions);
+        branches += search->stats.failures + search->stats.solutions;
+    }
+
+    if (stopped)
+    {
+        std::cerr << "time limit of " << searches.front()->time_limit << " s reached" << std::endl;
+    }
+    if (searches.empty() || searches.front()->count_all)
+    {
+        // the product of counts of which some were cut short is only a lower bound
+        std::cout << (stopped ? "solutions: at least " : "solutions: ") << count << std::endl;
+    }
+    else if (solved)
+    {
+        std::cout << branches << ". ";
+        for (size_t k = 0; k < searches.size(); k++)
+        {
+            std::cout << (k > 0 ? ", " : "");
+            searches[k]->print_assignment(std::cout, searches[k]->solution_order);
+        }
+        std::cout << "  solution\n";
+    }
+
+    if (print_stats)
+    {
+        for (size_t k = 0; k < searches.size(); k++)
+        {
+            std::cerr << "component " << k + 1 << " of " << searches.size() << ": "
+                      << std::string(components[k].begin(), components[k].end()) << "\n";
+            searches[k]->print_stats(std::cerr);
+        }
+    }
+}
+
+
+
+
+std::unordered_map<char, Domain> parse_variables (std::istream& input, std::vector<std::string>& errors)
+{
+    /**
+     * every line is "X: values" where a value is either a number or an inclusive range like 0..1000000
+     */
+    std::unordered_map<char, Domain> variables;
+    std::string line;
+
+    while (std::getline(input, line))
+    {
+        std::istringstream input_stream(line);
+        char var, colon;
+        std::string token;
+        std::vector<std::pair<int, int>> ranges;
+
+        if (!(input_stream >> var >> colon))
+        {
+            continue;
+        }
+
+        while (input_stream >> token)
+        {
+            size_t dots = token.find("..");
+            try
+            {
+                if (dots == std::string::npos)
+                {
+                    int value = std::stoi(token);
+                    ranges.emplace_back(value, value);
+                }
+                else
+                {
+                    ranges.emplace_back(std::stoi(token.substr(0, dots)), std::stoi(token.substr(dots + 2)));
+                }
+            }
+            catch (const std::exception&)
+            {
+                errors.push_back("cannot read value '" + token + "' of variable " + var);
+            }
+        }
+
+        variables[var] = Domain(std::move(ranges));
+    }
+    return variables;
+}
+
+
+std::unordered_map<char, Domain> get_variables_from_file (const std::string& var_file_path,
+                                                          std::vector<std::string>& errors)
+{
+    std::ifstream file(var_file_path);
+    return parse_variables(file, errors);
+}
+
+
+bool parse_constraint(const std::string& line, Constraint& constraint)
+{
+    /**
+     * read one constraint of the form "X op Y", "X op c*Y + k" or "X op k" where op is one of = ! < > <= >=
+     * (== and != are accepted as well). Spaces are optional. Returns false if the line is not a constraint
+     */
+    std::string text;
+    for (char c: line)
+    {
+        if (!std::isspace(static_cast<unsigned char>(c)))
+        {
+            text.push_back(c);
+        }
+    }
+    if (text.size() < 3)
+    {
+        return false;
+    }
+
+    size_t position = 0;
+    constraint = Constraint{};
+    constraint.var1 = text[position++];
+
+    std::string op;
+    while (position < text.size() && std::string("=!<>").find(text[position]) != std::string::npos && op.size() < 2)
+    {
+        op.push_back(text[position++]);
+    }
+    if (op == "=" || op == "==") constraint.op = '=';
+    else if (op == "!" || op == "!=") constraint.op = '!';
+    else if (op == "<") constraint.op = '<';
+    else if (op == ">") constraint.op = '>';
+    else if (op == "<=") constraint.op = 'L';
+    else if (op == ">=") constraint.op = 'G';
+    else return false;
+
+    // right hand side: [sign][number][*][variable][(+|-)number]
+    auto read_number = [&](long long& number) {
+        size_t start = position;
+        while (position < text.size() && std::isdigit(static_cast<unsigned char>(text[position])))
+        {
+            position++;
+        }
+        if (start == position)
+        {
+            return false;
+        }
+        number = std::stoll(text.substr(start, position - start));
+        return true;
+    };
+
+    long long sign = 1;
+    if (position < text.size() && (text[position] == '-' || text[position] == '+'))
+    {
+        sign = text[position++] == '-' ? -1 : 1;
+    }
+
+    long long number = 0;
+    bool has_number = read_number(number);
+    if (position < text.size() && text[position] == '*')
+    {
+        position++;
+    }
+
+    if (position < text.size() && std::isalpha(static_cast<unsigned char>(text[position])))
+    {
+        constraint.var2 = text[position++];
+        constraint.coef = static_cast<int>(sign * (has_number ? number : 1));
+        if (position < text.size())
+        {
+            long long offset_sign = text[position] == '-' ? -1 : 1;
+            if (text[position] != '-' && text[position] != '+')
+            {
+                return false;
+            }
+            position++;
+            if (position < text.size() && (text[position] == '-' || text[position] == '+'))
+            {
+                offset_sign *= text[position++] == '-' ? -1 : 1;
+            }
+            if (!read_number(number))
+            {
+                return false;
+            }
+            constraint.offset = static_cast<int>(offset_sign * number);
+        }
+    }
+    else
+    {
+        if (!has_number)
+        {
+            return false;
+        }
+        constraint.var2 = 0;
+        constraint.coef = 0;
+        constraint.offset = static_cast<int>(sign * number);
+    }
+    return position == text.size();
+}
+
+
+bool parse_linear(const std::string& line, std::vector<std::pair<char, long long>>& terms, char& op, long long& right)
+{
+    /**
+     * read a linear constraint "sum op sum" where both sides are sums of terms [sign][number][*]variable and of
+     * numbers, e.g. "A + 2*B - C <= 10" or "A + B = C + 3". Everything is moved over to "terms op right", with the
+     * terms of a variable added up and the ones that cancel out dropped. Returns false if the line is not linear
+     */
+    std::string text;
+    for (char c: line)
+    {
+        if (!std::isspace(static_cast<unsigned char>(c)))
+        {
+            text.push_back(c);
+        }
+    }
+
+    size_t op_start = text.find_first_of("=!<>");
+    if (op_start == std::string::npos)
+    {
+        return false;
+    }
+    size_t op_end = op_start;
+    while (op_end < text.size() && std::string("=!<>").find(text[op_end]) != std::string::npos && op_end - op_start < 2)
+    {
+        op_end++;
+    }
+    std::string symbol = text.substr(op_start, op_end - op_start);
+    if (symbol == "=" || symbol == "==") op = '=';
+    else if (symbol == "!" || symbol == "!=") op = '!';
+    else if (symbol == "<") op = '<';
+    else if (symbol == ">") op = '>';
+    else if (symbol == "<=") op = 'L';
+    else if (symbol == ">=") op = 'G';
+    else return false;
+
+    std::vector<std::pair<char, long long>> coefs;
+    right = 0;
+    auto read_side = [&](const std::string& side, long long side_sign) {
+        size_t position = 0;
+        if (side.empty())
+        {
+            return false;
+        }
+        while (position < side.size())
+        {
+            long long sign = 1;
+            if (side[position] == '+' || side[position] == '-')
+            {
+                sign = side[position++] == '-' ? -1 : 1;
+            }
+            else if (position > 0)
+            {
+                return false;
+            }
+
+            size_t start = position;
+            while (position < side.size() && std::isdigit(static_cast<unsigned char>(side[position])))
+            {
+                position++;
+            }
+            bool has_number = position > start;
+            long long number = has_number ? std::stoll(side.substr(start, position - start)) : 1;
+            if (position < side.size() && side[position] == '*')
+            {
+                position++;
+            }
+
+            if (position < side.size() && std::isalpha(static_cast<unsigned char>(side[position])))
+            {
+                char variable = side[position++];
+                auto found = std::find_if(coefs.begin(), coefs.end(), [&](const std::pair<char, long long>& term) {
+                    return term.first == variable;
+                });
+                if (found == coefs.end())
+                {
+                    coefs.emplace_back(variable, 0);
+                    found = coefs.end() - 1;
+                }
+                found->second += side_sign * sign * number;
+            }
+            else if (has_number)
+            {
+                right -= side_sign * sign * number;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!read_side(text.substr(0, op_start), 1) || !read_side(text.substr(op_end), -1))
+    {
+        return false;
+    }
+
+    terms.clear();
+    for (const auto& term: coefs)
+    {
+        if (term.second != 0)
+        {
+            terms.push_back(term);
+        }
+    }
+    return true;
+}
+
+
+char flip_operator(char op)
+{
+    /**
+     * the operator after multiplying both sides by -1
+     */
+    switch (op)
+    {
+        case '<': return '>';
+        case '>': return '<';
+        case 'L': return 'G';
+        case 'G': return 'L';
+        default: return op;
+    }
+}
+
+
+std::vector<Constraint> parse_constraints (std::istream& input, std::vector<std::unique_ptr<Propagator>>& propagators,
+                                           std::vector<std::string>& errors)
+{
+    /**
+     * one binary or unary constraint per line. A table constraint is a section
+     *     table A B C
+     *     1 2 3
+     *     ...
+     *     end
+     * listing the allowed tuples of its variables, one per line. "alldiff A B C" requires pairwise different values.
+     * A linear line like "A + 2*B - C <= 10" over one or two variables becomes a plain constraint when one of the
+     * coefficients is 1 or -1, and a linear constraint otherwise. "minimize 2*A + B" or "maximize A - C" declares the
+     * objective of an optimization problem
+     */
+    std::vector<Constraint> constraints;
+
+    std::string line;
+
+    while (std::getline(input, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        std::istringstream input_stream(line);
+        std::string keyword;
+        input_stream >> keyword;
+        if (keyword == "table")
+        {
+            std::vector<char> scope;
+            char variable;
+            while (input_stream >> variable)
+            {
+                scope.push_back(variable);
+            }
+
+            std::vector<std::vector<int>> tuples;
+            while (std::getline(input, line))
+            {
+                std::istringstream tuple_stream(line);
+                std::string first;
+                if (!(tuple_stream >> first))
+                {
+                    continue;
+                }
+                if (first == "end")
+                {
+                    break;
+                }
+
+                std::vector<int> tuple;
+                tuple_stream.clear();
+                tuple_stream.seekg(0);
+                int value;
+                while (tuple_stream >> value)
+                {
+                    tuple.push_back(value);
+                }
+                if (tuple.size() != scope.size())
+                {
+                    errors.push_back("tuple '" + line + "' does not match the table scope");
+                    continue;
+                }
+                tuples.push_back(std::move(tuple));
+            }
+            propagators.push_back(std::make_unique<TableConstraint>(std::move(scope), std::move(tuples)));
+            continue;
+        }
+        if (keyword == "minimize" || keyword == "maximize")
+        {
+            // the objective is read as the left side of a linear line; its constant ends up on the right side
+            std::vector<std::pair<char, long long>> terms;
+            char op = 0;
+            long long right = 0;
+            std::string expression = line.substr(line.find(keyword) + keyword.size());
+            if (!parse_linear(expression + " = 0", terms, op, right))
+            {
+                errors.push_back("cannot read objective '" + line + "'");
+            }
+            else if (terms.empty())
+            {
+                errors.push_back("objective '" + line + "' has no variables");
+            }
+            else
+            {
+                propagators.push_back(std::make_unique<Objective>(std::move(terms), keyword == "maximize", -right));
+            }
+            continue;
+        }
+        if (keyword == "alldiff")
+        {
+            std::vector<char> scope;
+            char variable;
+            while (input_stream >> variable)
+            {
+                scope.push_back(variable);
+            }
+            propagators.push_back(std::make_unique<AllDifferent>(std::move(scope)));
+            continue;
+        }
+
+        Constraint c{};
+        std::vector<std::pair<char, long long>> terms;
+        char op = 0;
+        long long right = 0;
+        if (parse_constraint(line, c))
+        {
+            constraints.push_back(c);
+        }
+        else if (!parse_linear(line, terms, op, right))
+        {
+            errors.push_back("cannot read constraint '" + line + "'");
+        }
+        else if (terms.empty())
+        {
+            errors.push_back("constraint '" + line + "' has no variables");
+        }
+        else
+        {
+            // put a term with coefficient 1 or -1 first, so "X op coef * Y + offset" can express it
+            auto unit = std::find_if(terms.begin(), terms.end(), [](const std::pair<char, long long>& term) {
+                return term.second == 1 || term.second == -1;
+            });
+            bool fits = terms.size() <= 2 && unit != terms.end() && right >= INT_MIN && right <= INT_MAX;
+            if (fits)
+            {
+                std::iter_swap(terms.begin(), unit);
+                long long sign = terms[0].second;
+                long long coef = terms.size() == 2 ? -sign * terms[1].second : 0;
+                fits = coef >= INT_MIN && coef <= INT_MAX;
+                c = Constraint{terms[0].first, terms.size() == 2 ? terms[1].first : char(0),
+                               sign < 0 ? flip_operator(op) : op, static_cast<int>(coef), static_cast<int>(sign * right)};
+            }
+            if (fits)
+            {
+                constraints.push_back(c);
+            }
+            else
+            {
+                propagators.push_back(std::make_unique<LinearConstraint>(std::move(terms), op, right));
+            }
+        }
+    }
+
+    return constraints;
+}
+
+
+std::vector<Constraint> get_constraints_from_file (const std::string& const_file_path,
+                                                    std::vector<std::unique_ptr<Propagator>>& propagators,
+                                                    std::vector<std::string>& errors)
+{
+    std::ifstream file(const_file_path);
+    return parse_constraints(file, propagators, errors);
+}
+
+
+PreprocessResult preprocess_network(std::unordered_map<char, Domain>& variables, std::vector<Constraint>& constraints,
+                                    const std::vector<std::unique_ptr<Propagator>>& propagators)
+{
+    /**
+     * shrink the network before the search:
+     *   - variables tied by "X = Y" are merged into the smaller one with union-find, intersecting their domains.
+     *     Variables of n-ary constraints are left alone, their scopes would need rewriting
+     *   - strict operators become non-strict ones (X < Y + k is X <= Y + k - 1) and constraints with a coefficient
+     *     of 1 or -1 are written with the smaller variable first, so mirrored pairs look the same
+     *   - a constraint of a variable with itself becomes a unary one or is decided right away
+     *   - duplicates are dropped, bounds on the same pair are tightened to the strongest one, and pairs that can
+     *     never hold together (A < B with B < A) are reported
+     */
+    PreprocessResult result;
+    const size_t original_count = constraints.size();
+
+    auto report_conflict = [&](char variable, const std::string& reason) {
+        if (!result.unsatisfiable)
+        {
+            result.unsatisfiable = true;
+            result.conflict = reason;
+            variables[variable] = Domain();
+        }
+    };
+
+    // merge the equal variables
+    std::vector<char> in_scope(256, 0);
+    for (const auto& propagator: propagators)
+    {
+        for (char variable: propagator->scope)
+        {
+            in_scope[static_cast<unsigned char>(variable)] = 1;
+        }
+    }
+    std::vector<char> parent(256);
+    for (size_t c = 0; c < parent.size(); c++)
+    {
+        parent[c] = static_cast<char>(c);
+    }
+    std::function<char(char)> root = [&](char variable) {
+        char& up = parent[static_cast<unsigned char>(variable)];
+        if (up != variable)
+        {
+            up = root(up);
+        }
+        return up;
+    };
+    for (const auto& constraint: constraints)
+    {
+        if (constraint.op != '=' || constraint.is_unary() || constraint.coef != 1 || constraint.offset != 0 ||
+            in_scope[static_cast<unsigned char>(constraint.var1)] || in_scope[static_cast<unsigned char>(constraint.var2)] ||
+            !variables.count(constraint.var1) || !variables.count(constraint.var2))
+        {
+            continue;
+        }
+        char a = root(constraint.var1);
+        char b = root(constraint.var2);
+        if (a != b)
+        {
+            parent[static_cast<unsigned char>(std::max(a, b))] = std::min(a, b);
+        }
+    }
+
+    std::vector<char> names;
+    for (const auto& entry: variables)
+    {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    for (char variable: names)
+    {
+        char representative = root(variable);
+        if (representative == variable)
+        {
+            continue;
+        }
+        const std::vector<Domain::Interval>& a = variables.at(representative).get_intervals();
+        const std::vector<Domain::Interval>& b = variables.at(variable).get_intervals();
+        std::vector<std::pair<int, int>> common;
+        for (size_t i = 0, j = 0; i < a.size() && j < b.size();)
+        {
+            common.emplace_back(std::max(a[i].lo, b[j].lo), std::min(a[i].hi, b[j].hi));
+            a[i].hi < b[j].hi ? i++ : j++;
+        }
+        variables[representative] = Domain(std::move(common));
+        variables.erase(variable);
+        result.merged.emplace_back(variable, representative);
+        if (variables.at(representative).empty())
+        {
+            report_conflict(representative, std::string("the domains of ") + representative + " and " + variable +
+                                            " have no common value");
+        }
+    }
+
+    // normalize every constraint; returns false if it always holds and can be dropped
+    auto normalize = [&](Constraint& constraint) {
+        constraint.var1 = root(constraint.var1);
+        if (constraint.is_unary())
+        {
+            constraint.var2 = 0;
+            constraint.coef = 0;
+        }
+        else
+        {
+            constraint.var2 = root(constraint.var2);
+        }
+        if (constraint.op == '<' && constraint.offset != INT_MIN)
+        {
+            constraint.op = 'L';
+            constraint.offset--;
+        }
+        else if (constraint.op == '>' && constraint.offset != INT_MAX)
+        {
+            constraint.op = 'G';
+            constraint.offset++;
+        }
+        if (constraint.op == '<' || constraint.op == '>')
+        {
+            return true;
+        }
+
+        if (!constraint.is_unary() && constraint.var1 == constraint.var2)
+        {
+            // X op c*X + k is (1 - c) * X op k
+            long long factor = 1 - static_cast<long long>(constraint.coef);
+            long long right = constraint.offset;
+            char op = constraint.op;
+            std::string text = std::string(1, constraint.var1) + " " + operator_symbol(op) + " " +
+                               (constraint.coef != 1 ? std::to_string(constraint.coef) + "*" : "") + constraint.var1 +
+                               (right != 0 ? " + " + std::to_string(right) : "");
+            if (factor == 0)
+            {
+                bool holds = op == 'L' ? 0 <= right : op == 'G' ? 0 >= right : op == '=' ? right == 0 : right != 0;
+                if (!holds)
+                {
+                    report_conflict(constraint.var1, text + " never holds");
+                }
+                return false;
+            }
+            if (factor < 0)
+            {
+                factor = -factor;
+                right = -right;
+                op = flip_operator(op);
+            }
+            long long bound = op == 'G' ? ceil_div(right, factor) : floor_div(right, factor);
+            bool exact = right % factor == 0;
+            if (op == '!' && !exact)
+            {
+                return false;
+            }
+            if (op == '=' && !exact)
+            {
+                report_conflict(constraint.var1, text + " never holds");
+                return false;
+            }
+            constraint = Constraint{constraint.var1, 0, op, 0,
+                                    static_cast<int>(std::min<long long>(std::max<long long>(bound, INT_MIN), INT_MAX))};
+            return true;
+        }
+
+        if (!constraint.is_unary() && constraint.var1 > constraint.var2 &&
+            (constraint.coef == 1 || constraint.coef == -1) && constraint.offset != INT_MIN)
+        {
+            // X op Y + k is Y op' X - k, and X op -Y + k is Y op -X + k
+            std::swap(constraint.var1, constraint.var2);
+            if (constraint.coef == 1)
+            {
+                constraint.op = flip_operator(constraint.op);
+                constraint.offset = -constraint.offset;
+            }
+        }
+        return true;
+    };
+
+    std::vector<Constraint> normalized;
+    for (Constraint constraint: constraints)
+    {
+        if (normalize(constraint))
+        {
+            normalized.push_back(constraint);
+        }
+    }
+
+    // group the constraints on the same pair and coefficient, then keep the strongest of them
+    auto key = [](const Constraint& constraint) {
+        return std::make_tuple(constraint.var1, constraint.var2, constraint.coef);
+    };
+    std::sort(normalized.begin(), normalized.end(), [&](const Constraint& a, const Constraint& b) {
+        return std::make_tuple(a.var1, a.var2, a.coef, a.op, a.offset) <
+               std::make_tuple(b.var1, b.var2, b.coef, b.op, b.offset);
+    });
+
+    constraints.clear();
+    for (size_t start = 0; start < normalized.size();)
+    {
+        size_t end = start;
+        while (end < normalized.size() && key(normalized[end]) == key(normalized[start]))
+        {
+            end++;
+        }
+        // var1 - coef * var2 must lie in [lo, hi], must equal a value if it is set, and may not be one of excluded
+        long long lo = LLONG_MIN;
+        long long hi = LLONG_MAX;
+        std::vector<long long> excluded;
+        std::vector<Constraint> others;
+        for (size_t index = start; index < end; index++)
+        {
+            const Constraint& constraint = normalized[index];
+            switch (constraint.op)
+            {
+                case 'L': hi = std::min<long long>(hi, constraint.offset); break;
+                case 'G': lo = std::max<long long>(lo, constraint.offset); break;
+                case '=':
+                    lo = std::max<long long>(lo, constraint.offset);
+                    hi = std::min<long long>(hi, constraint.offset);
+                    break;
+                case '!': excluded.push_back(constraint.offset); break;
+                default: others.push_back(constraint); break;
+            }
+        }
+        excluded.erase(std::unique(excluded.begin(), excluded.end()), excluded.end());
+
+        const Constraint& first = normalized[start];
+        std::string pair = first.is_unary() ? std::string(1, first.var1)
+                                            : std::string(1, first.var1) + " and " + first.var2;
+        if (lo > hi)
+        {
+            report_conflict(first.var1, "the constraints on " + pair + " contradict each other");
+        }
+        else if (lo == hi && std::find(excluded.begin(), excluded.end(), lo) != excluded.end())
+        {
+            report_conflict(first.var1, "the constraints on " + pair + " contradict each other");
+        }
+
+        Constraint bound = first;
+        if (lo == hi)
+        {
+            bound.op = '=';
+            bound.offset = static_cast<int>(lo);
+            constraints.push_back(bound);
+        }
+        else
+        {
+            if (lo != LLONG_MIN)
+            {
+                bound.op = 'G';
+                bound.offset = static_cast<int>(lo);
+                constraints.push_back(bound);
+            }
+            if (hi != LLONG_MAX)
+            {
+                bound.op = 'L';
+                bound.offset = static_cast<int>(hi);
+                constraints.push_back(bound);
+            }
+            for (long long value: excluded)
+            {
+                // a value outside the bounds is excluded already
+                if (value >= lo && value <= hi)
+                {
+                    bound.op = '!';
+                    bound.offset = static_cast<int>(value);
+                    constraints.push_back(bound);
+                }
+            }
+        }
+        constraints.insert(constraints.end(), others.begin(), others.end());
+        start = end;
+    }
+
+    result.removed_constraints = original_count > constraints.size() ? original_count - constraints.size() : 0;
+    return result;
+}
+
+
+void print_solution(long long number, const std::vector<char>& order, const std::unordered_map<char, int>& solution,
+                    const std::vector<std::pair<char, char>>& merged)
+{
+    /**
+     * print a solution found without the search in the format of the trace, with the merged variables after the one
+     * they were merged into
+     */
+    std::cout << number << ". ";
+    for (size_t j = 0; j < order.size(); j++)
+    {
+        std::cout << (j > 0 ? ", " : "") << order[j] << "=" << solution.at(order[j]);
+        for (const auto& alias: merged)
+        {
+            if (alias.second == order[j])
+            {
+                std::cout << ", " << alias.first << "=" << solution.at(order[j]);
+            }
+        }
+    }
+    std::cout << "  solution\n";
+}
@@ -0,0 +1,605 @@
+#ifndef CSP_SOLVER_HPP
+#define CSP_SOLVER_HPP
+
+/**
+ * internal header of the csp library: the CSP class that holds the state of one search, and the searches over it.
+ * The model it searches is in model.hpp, the counters it keeps in instrumentation.hpp. Applications include
+ * csp/csp.hpp or csp/csp.h instead
+ */
+
+#include "csp/csp.hpp"
+#include "instrumentation.hpp"
+#include "model.hpp"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * bump allocator for the scratch data of the search nodes. Memory is handed out in stack order and given back all
+ * at once by rewinding to a mark, so a node's temporaries are released when the node returns. The chunks are kept
+ * after a rewind, which means that once the deepest path has been visited the search no longer touches the heap
+ */
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+    };
+
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+
+    Mark mark() const
+    {
+        return {current, offset};
+    }
+
+
+    void rewind(Mark position)
+    {
+        current = position.chunk;
+        offset = position.offset;
+    }
+
+
+    size_t reserved_bytes() const
+    {
+        size_t total = 0;
+        for (const auto& chunk: chunks)
+        {
+            total += chunk.size;
+        }
+        return total;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        while (true)
+        {
+            if (current < chunks.size())
+            {
+                size_t aligned = (offset + alignment - 1) / alignment * alignment;
+                if (aligned + bytes <= chunks[current].size)
+                {
+                    offset = aligned + bytes;
+                    return chunks[current].data.get() + aligned;
+                }
+
+                // the rest of this chunk is too small; use the next one if the request fits in it
+                if (current + 1 < chunks.size() && bytes + alignment <= chunks[current + 1].size)
+                {
+                    current++;
+                    offset = 0;
+                    continue;
+                }
+            }
+
+            size_t size = chunks.empty() ? initial_chunk_size : chunks.back().size * 2;
+            while (size < bytes + alignment)
+            {
+                size *= 2;
+            }
+            size_t position = chunks.empty() ? 0 : current + 1;
+            chunks.insert(chunks.begin() + static_cast<long>(position), Chunk{std::make_unique<unsigned char[]>(size), size});
+            current = position;
+            offset = 0;
+        }
+    }
+
+
+    void do_deallocate(void*, size_t, size_t) override
+    {
+        // memory is only given back by rewind()
+    }
+
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t initial_chunk_size = 64 * 1024;
+
+    struct Chunk {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+    size_t offset = 0;
+};
+
+
+/**
+ * scope guard that gives back everything allocated from an arena during its lifetime
+ */
+class ArenaFrame {
+public:
+    explicit ArenaFrame(ScratchArena& arena) : arena(arena), position(arena.mark()) {}
+
+    ~ArenaFrame()
+    {
+        arena.rewind(position);
+    }
+
+    ArenaFrame(const ArenaFrame&) = delete;
+    ArenaFrame& operator=(const ArenaFrame&) = delete;
+
+private:
+    ScratchArena& arena;
+    ScratchArena::Mark position;
+};
+
+
+template <typename T>
+class Generator;
+
+
+class CSP {
+public:
+    // scratch memory of the search nodes: its own, or one that outlives it so a batch worker can reuse the chunks
+    // from instance to instance. A reference, so that the const queries can allocate their temporaries
+    ScratchArena own_arena;
+    ScratchArena& arena;
+    // recycles the nodes of the assignment hashmap so assigning and un-assigning does not go to the heap
+    std::pmr::unsynchronized_pool_resource assignment_pool;
+    // hashmap to hold assigned variables and their values. If a variable is unassigned it won't exist in this hashmap
+    std::pmr::unordered_map<char, int> assignment{&assignment_pool};
+    // the problem this search works on; shared with every other search of it
+    std::shared_ptr<const Model> model;
+    // holds the domain of an instance of a CSP problem. The values of every domain are kept sorted as intervals so
+    // that the smallest and largest value are at the ends and the order constraints can be handled with binary searches
+    std::unordered_map<char, Domain> domain;
+    // holds all the constraints of a csp. This does not change at all during any of the search states
+    const std::vector<Constraint>& constraints;
+    const std::unordered_map<char, std::vector<size_t>>& constraints_of;
+    // the n-ary constraints, and for every variable the indices of the ones it is part of
+    const std::vector<std::unique_ptr<Propagator>>& propagators;
+    const std::unordered_map<char, std::vector<size_t>>& propagators_of;
+    const Objective* objective;
+    // the search state of the n-ary constraints; every one of them owns the words from its state_offset on
+    std::vector<uint64_t> propagator_state;
+    // whether the search does forward checking; fixed when the csp is built
+    csp::Consistency consistency;
+    // counters of the current search
+    SearchStats stats;
+    // domains with more values than this are split in two halves instead of being enumerated value by value
+    long long split_threshold = 1024;
+    // hardware counters for the hot regions; null unless the solver was started with --perf
+    PerfCounters* perf = nullptr;
+    // running estimate of the total size of the search tree
+    TreeSizeEstimator tree_estimate;
+    // print the progress every progress_interval seconds; 0 disables the periodic report
+    double progress_interval = 0.0;
+    double next_progress_report = 0.0;
+
+    // the domains changed by forward checking, saved so they can be restored when we backtrack. The saved values
+    // of all entries are stored one after another in trail_values
+    struct TrailEntry {
+        char variable;
+        size_t offset;
+        size_t count;
+    };
+    std::vector<TrailEntry> trail;
+    std::vector<Domain::Interval> trail_values;
+    // the state of the propagators is kept in words that are saved here with their old value before they change
+    std::vector<std::pair<uint64_t*, uint64_t>> word_trail;
+
+    // the variables that preprocessing merged into each variable; they are printed with its value in a solution
+    std::unordered_map<char, std::vector<char>> aliases;
+
+    // count every solution instead of stopping at the first one
+    bool count_all = false;
+    // do not print the failure and solution lines of the trace
+    bool quiet = false;
+    // the order in which the variables of the first solution were assigned; its values stay in assignment
+    std::vector<char> solution_order;
+    // count with component caching, keeping the cache under this many bytes; 0 counts by plain enumeration
+    size_t cache_limit_bytes = 0;
+    // called with the assignment order at every solution; the search goes on while it returns true
+    std::function<bool(const std::vector<char>&)> on_solution;
+    // the sum of the objective must stay below this; branch and bound lowers it to every better solution it finds
+    long long objective_bound = LLONG_MAX;
+    // the search stops after this many seconds, or after visiting this many nodes; 0 lets it run to the end
+    double time_limit = 0.0;
+    long long node_limit = 0;
+    bool timed_out = false;
+    bool out_of_nodes = false;
+    // a warm start: the value to try first for each variable, usually from an earlier solution of a similar problem
+    std::unordered_map<char, int> preferred_values;
+
+    // a position on both trails to backtrack to
+    struct TrailMark {
+        size_t domains;
+        size_t words;
+    };
+
+    CSP(std::shared_ptr<const Model> problem, csp::Consistency consistency, ScratchArena* shared_arena = nullptr);
+
+    CSP(std::unordered_map<char, Domain> variables,
+        const std::vector<Constraint>& constraints,
+        csp::Consistency consistency,
+        std::vector<std::unique_ptr<Propagator>> n_ary_constraints = {},
+        ScratchArena* shared_arena = nullptr);
+
+
+    const std::vector<size_t>& constraints_of_variable(char variable) const
+    {
+        /**
+         * the indices of the binary constraints the variable is part of, in the order of the constraints
+         */
+        static const std::vector<size_t> none;
+        auto involved = constraints_of.find(variable);
+        return involved != constraints_of.end() ? involved->second : none;
+    }
+
+
+    bool is_complete_assignment()
+    {
+        /**
+         * all variables have been assigned values; solution possible
+         */
+        return assignment.size() == domain.size();
+    }
+
+
+    bool is_solution() {
+        /**
+         * Check if every constraint passes the current assignment of variables
+         * This function is only called whenever we have a complete assignment of variables
+         */
+
+        for (const auto& constraint: constraints)
+        {
+            if (!constraint.holds(assignment.at(constraint.var1), assignment.at(constraint.var2)))
+            {
+                return false;
+            }
+
+        }
+
+        for (const auto& propagator: propagators)
+        {
+            if (!propagator->holds(*this))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    bool is_consistent(char variable, int value) const
+    {
+        /**
+         * Check that the variable and value assigned to it passes the constraint it involves.
+         * If the variable is on one side of a constraint then that constraint has to be checked
+         * against all other assigned variables.
+         */
+        PerfRegion region(perf, Region::IsConsistent);
+        for (size_t index : constraints_of_variable(variable)) {
+            const Constraint& constraint = constraints[index];
+            char other_var = constraint.var1 == variable ? constraint.var2 : constraint.var1;
+
+            // Check if the other variable is assigned
+            auto it = assignment.find(other_var);
+            if (it != assignment.end()) {
+                int other_value = it->second; // Get the assigned value for the other variable
+
+                // Perform the check based on who is var1 and who is var2 in the constraint
+                if ((constraint.var1 == variable && !constraint.holds(value, other_value)) ||
+                    (constraint.var2 == variable && !constraint.holds(other_value, value))) {
+                    return false;
+                }
+            }
+        }
+
+        auto involved = propagators_of.find(variable);
+        if (involved != propagators_of.end())
+        {
+            for (size_t index: involved->second)
+            {
+                if (!propagators[index]->is_consistent(*this, variable, value))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+
+    std::pmr::vector<char> get_un_assigned_variables () const;
+
+
+    long long get_domain_count (char variable) const
+    {
+        long long domain_count = -1;
+        if (domain.find(variable) != domain.end())
+        {
+            domain_count = domain.at(variable).size();
+        }
+        else
+        {
+            std::cerr << "error - variable doesn't exist in the domain\n";
+        }
+        return domain_count;
+    }
+
+
+    int get_domain_min(char variable) const
+    {
+        return domain.at(variable).min();
+    }
+
+
+    int get_domain_max(char variable) const
+    {
+        return domain.at(variable).max();
+    }
+
+
+    int get_constraint_count(char variable) const;
+
+    char select_variable() const;
+
+    std::pmr::vector<Constraint> get_constraints(char variable) const;
+
+    std::pmr::vector<int> select_values(char variable) const;
+
+    bool forward_checking(char variable, int value);
+
+
+    void save_domain(char variable)
+    {
+        /**
+         * push the current domain of a variable on the trail
+         */
+        const std::vector<Domain::Interval>& intervals = domain.at(variable).get_intervals();
+        trail.push_back({variable, trail_values.size(), intervals.size()});
+        trail_values.insert(trail_values.end(), intervals.begin(), intervals.end());
+    }
+
+
+    void save_word(uint64_t& word)
+    {
+        /**
+         * push a word of the state of a propagator on the trail before it changes
+         */
+        word_trail.emplace_back(&word, word);
+    }
+
+
+    TrailMark trail_mark() const
+    {
+        return {trail.size(), word_trail.size()};
+    }
+
+
+    void restore_domain(TrailMark mark)
+    {
+        /**
+         * restore the domain for when we backtrack for searches with forward checking: undo every change saved on the
+         * trails after the mark, newest first
+         */
+        while (trail.size() > mark.domains)
+        {
+            const TrailEntry& entry = trail.back();
+            domain.at(entry.variable).restore(trail_values.data() + entry.offset, entry.count);
+            trail_values.resize(entry.offset);
+            trail.pop_back();
+        }
+        while (word_trail.size() > mark.words)
+        {
+            *word_trail.back().first = word_trail.back().second;
+            word_trail.pop_back();
+        }
+    }
+
+
+    bool propagate_constraints(char changed_variable, size_t changed_from);
+
+
+    bool narrow_domain(char variable, long long lo, long long hi)
+    {
+        /**
+         * keep only the values of the variable in [lo, hi], saving the domain on the trail first if anything changes.
+         * Returns true if the domain changed
+         */
+        Domain& values = domain.at(variable);
+        if (values.empty() || (values.min() >= lo && values.max() <= hi))
+        {
+            return false;
+        }
+        save_domain(variable);
+        return values.restrict(lo, hi);
+    }
+
+
+    bool split_domain(char variable, long long middle, bool lower_half)
+    {
+        /**
+         * restrict the variable to the values up to middle, or to the ones after it. Returns false if nothing is left
+         */
+        if (lower_half)
+        {
+            narrow_domain(variable, LLONG_MIN, middle);
+        }
+        else
+        {
+            narrow_domain(variable, middle + 1, LLONG_MAX);
+        }
+        return !domain.at(variable).empty();
+    }
+
+
+    bool propagate_bounds(char changed_variable);
+
+
+    void assign_variable(char variable, int value) {
+        /**
+         * assign a variable. Its domain is kept as it is: assigned variables are never looked at again until they are
+         * un-assigned, and the values are needed again when that happens
+         */
+         assignment[variable] = value;
+    }
+
+
+    void un_assign_variable(char variable) {
+        /**
+         * un-assign a variable
+         */
+         assignment.erase(variable);
+    }
+
+
+    void print_domain ();
+
+    void print_constraints();
+
+    void print_stats(std::ostream& out) const;
+
+    long long get_unassigned_domain_size() const;
+
+
+    void sample_trace_counters(int depth) const
+    {
+        /**
+         * add the depth and the remaining domain sizes to the trace timeline, sampled every 64 nodes
+         */
+        if (trace_recorder.is_enabled() && (stats.nodes & 63) == 1)
+        {
+            trace_recorder.counter("depth", "depth", depth);
+            trace_recorder.counter("domain size", "unassigned values", get_unassigned_domain_size());
+        }
+    }
+
+
+    void print_progress(std::ostream& out, int depth) const;
+
+
+    void poll_progress(int depth)
+    {
+        /**
+         * called once per node: print the progress when SIGUSR1 arrived or the reporting interval has elapsed
+         */
+        bool due = progress_requested != 0;
+        if (!due && progress_interval > 0 && (stats.nodes & 255) == 0)
+        {
+            due = stats.elapsed_seconds() >= next_progress_report;
+        }
+
+        if (due)
+        {
+            progress_requested = 0;
+            next_progress_report = stats.elapsed_seconds() + progress_interval;
+            print_progress(std::cerr, depth);
+        }
+    }
+
+
+    bool assign_preferred_values(std::vector<char>& order);
+
+
+    bool limit_reached()
+    {
+        /**
+         * called once per node: true from the moment the search has run for time_limit seconds or visited node_limit
+         * nodes
+         */
+        if (node_limit > 0 && stats.nodes >= node_limit)
+        {
+            out_of_nodes = true;
+        }
+        if (!timed_out && time_limit > 0 && (stats.nodes & 255) == 0)
+        {
+            timed_out = stats.elapsed_seconds() >= time_limit;
+        }
+        return stopped();
+    }
+
+
+    bool stopped() const
+    {
+        /**
+         * true once limit_reached has ended the search
+         */
+        return timed_out || out_of_nodes;
+    }
+
+
+    void print_failure(const std::vector<char>& var_ordering, int i, int curr_value_fail);
+
+    void print_success(const std::vector<char>& var_ordering, int i);
+
+    void print_assignment(std::ostream& out, const std::vector<char>& var_ordering) const;
+
+};
+
+
+inline uint64_t* Propagator::state(CSP& csp) const
+{
+    return csp.propagator_state.data() + state_offset;
+}
+
+
+inline const uint64_t* Propagator::state(const CSP& csp) const
+{
+    return csp.propagator_state.data() + state_offset;
+}
+
+
+// how the search of a subtree ended
+enum class SearchResult {
+    Exhausted,  // searched to the end, with everything it changed undone
+    Found,      // told to stop at a solution, which is left assigned
+    Stopped     // ended by the time or node limit, with everything it changed undone
+};
+
+
+// a search compiled for one combination of propagation, variable order and value order
+using SearchFunction = SearchResult (*)(int& i, std::vector<char>& order_vars_assigned, CSP& csp);
+
+
+SearchFunction search_for_mode(csp::Consistency consistency, bool guided = false);
+
+
+/**
+ * the solutions of the search one at a time, as the order the variables were assigned in; their values are in
+ * csp.assignment. Each next() goes on from the last solution, so only the solutions that are asked for are searched
+ */
+Generator<std::vector<char>> generate_solutions(CSP& csp);
+
+
+bool backtrack_search(CSP& csp);
+
+
+/**
+ * search for the solution with the smallest sum of csp.objective. Every solution found is better than the ones before
+ * and is passed to on_improvement, which stops the search by returning false; its sum then becomes the objective bound.
+ * Returns true if there was a solution; the last one is optimal unless the search was stopped
+ */
+bool branch_and_bound(CSP& csp, const std::function<bool(const std::vector<char>&)>& on_improvement);
+
+
+void solve_components(std::unordered_map<char, Domain>& variables, std::vector<Constraint>& constraints,
+                      std::vector<std::unique_ptr<Propagator>>& propagators,
+                      const std::vector<std::vector<char>>& components, csp::Consistency consistency, int threads,
+                      const std::function<void(CSP&)>& configure, bool print_stats);
+
+#endif
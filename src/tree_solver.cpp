@@ -0,0 +1,383 @@
+#include "tree_solver.hpp"
+
+#include <algorithm>
+
+
+bool TreeSolver::prepare(size_t max_cutset, long long max_domain, std::string& reason)
+{
+    /**
+     * enumerate the domains, build the constraint graph and find a cycle cutset. Returns false with a reason if
+     * the network is not one for this solver
+     */
+    std::vector<std::pair<int, int>> ranges;
+    for (const auto& entry: variables)
+    {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    index_of.assign(256, -1);
+    for (size_t v = 0; v < names.size(); v++)
+    {
+        index_of[static_cast<unsigned char>(names[v])] = static_cast<int>(v);
+        const Domain& domain = variables.at(names[v]);
+        if (domain.size() > max_domain)
+        {
+            reason = std::string("the domain of ") + names[v] + " is too large to enumerate";
+            return false;
+        }
+        values.emplace_back(domain.begin(), domain.end());
+    }
+
+    neighbours.assign(names.size(), {});
+    for (const auto& constraint: constraints)
+    {
+        int u = index_of[static_cast<unsigned char>(constraint.var1)];
+        int w = constraint.is_unary() ? u : index_of[static_cast<unsigned char>(constraint.var2)];
+        if (u < 0 || w < 0)
+        {
+            reason = "a constraint uses a variable without a domain";
+            return false;
+        }
+        if (u == w)
+        {
+            // unary constraints and constraints of a variable with itself just filter its values
+            std::vector<int>& kept = values[u];
+            kept.erase(std::remove_if(kept.begin(), kept.end(), [&](int value) {
+                return !constraint.holds(value, constraint.is_unary() ? 0 : value);
+            }), kept.end());
+            continue;
+        }
+
+        size_t edge = edge_between(u, w);
+        if (edge == edges.size())
+        {
+            edges.push_back({std::min(u, w), std::max(u, w), {}});
+            neighbours[u].emplace_back(w, edge);
+            neighbours[w].emplace_back(u, edge);
+        }
+        edges[edge].constraints.push_back(constraint);
+    }
+
+    find_cutset();
+    if (cutset.size() > max_cutset)
+    {
+        reason = "the cycle cutset has " + std::to_string(cutset.size()) + " variables";
+        return false;
+    }
+    in_cutset.assign(names.size(), 0);
+    for (int v: cutset)
+    {
+        in_cutset[v] = 1;
+    }
+    return true;
+}
+
+
+bool TreeSolver::solve(std::unordered_map<char, int>& solution)
+{
+    /**
+     * find one solution; the values end up in solution
+     */
+    cutset_assignments = 0;
+    unsigned long long found = 0;
+    std::vector<int> assigned(names.size(), 0);
+    enumerate_cutset(0, assigned, false, found);
+    if (found == 0)
+    {
+        return false;
+    }
+    for (size_t v = 0; v < names.size(); v++)
+    {
+        solution[names[v]] = first_solution[v];
+    }
+    return true;
+}
+
+
+unsigned long long TreeSolver::count()
+{
+    /**
+     * the number of solutions: the sum over the cutset assignments of the solutions of the forest, which are
+     * counted from the leaves up (modulo 2^64)
+     */
+    cutset_assignments = 0;
+    unsigned long long total = 0;
+    std::vector<int> assigned(names.size(), 0);
+    enumerate_cutset(0, assigned, true, total);
+    return total;
+}
+
+
+size_t TreeSolver::edge_between(int u, int w) const
+{
+    for (const auto& neighbour: neighbours[u])
+    {
+        if (neighbour.first == w)
+        {
+            return neighbour.second;
+        }
+    }
+    return edges.size();
+}
+
+
+bool TreeSolver::compatible(size_t edge, int u, int a, int b) const
+{
+    /**
+     * every constraint of the edge holds with value a for its variable u and b for the other one
+     */
+    for (const auto& constraint: edges[edge].constraints)
+    {
+        bool forward = index_of[static_cast<unsigned char>(constraint.var1)] == u;
+        if (!(forward ? constraint.holds(a, b) : constraint.holds(b, a)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void TreeSolver::find_cutset()
+{
+    /**
+     * greedy cycle cutset: strip the variables with at most one neighbour left (they are on no cycle) until none
+     * remain, then move the variable with the most neighbours left to the cutset and repeat
+     */
+    std::vector<char> removed(names.size(), 0);
+    std::vector<size_t> degree(names.size());
+    for (size_t v = 0; v < names.size(); v++)
+    {
+        degree[v] = neighbours[v].size();
+    }
+    auto remove = [&](int v) {
+        removed[v] = 1;
+        for (const auto& neighbour: neighbours[v])
+        {
+            degree[neighbour.first]--;
+        }
+    };
+
+    while (true)
+    {
+        bool stripped = true;
+        while (stripped)
+        {
+            stripped = false;
+            for (size_t v = 0; v < names.size(); v++)
+            {
+                if (!removed[v] && degree[v] <= 1)
+                {
+                    remove(static_cast<int>(v));
+                    stripped = true;
+                }
+            }
+        }
+
+        int most = -1;
+        for (size_t v = 0; v < names.size(); v++)
+        {
+            if (!removed[v] && (most < 0 || degree[v] > degree[most]))
+            {
+                most = static_cast<int>(v);
+            }
+        }
+        if (most < 0)
+        {
+            return;
+        }
+        cutset.push_back(most);
+        remove(most);
+    }
+}
+
+
+void TreeSolver::enumerate_cutset(size_t position, std::vector<int>& assigned, bool counting, unsigned long long& found)
+{
+    /**
+     * assign the cutset variables one by one, consistently with the ones before, and solve or count the forest
+     * that every complete cutset assignment leaves
+     */
+    if (!counting && found > 0)
+    {
+        return;
+    }
+    if (position == cutset.size())
+    {
+        cutset_assignments++;
+        found += solve_forest(assigned, counting);
+        return;
+    }
+
+    int v = cutset[position];
+    for (int value: values[v])
+    {
+        bool consistent = true;
+        for (size_t before = 0; before < position && consistent; before++)
+        {
+            int u = cutset[before];
+            size_t edge = edge_between(v, u);
+            consistent = edge == edges.size() || compatible(edge, v, value, assigned[u]);
+        }
+        if (consistent)
+        {
+            assigned[v] = value;
+            enumerate_cutset(position + 1, assigned, counting, found);
+        }
+    }
+}
+
+
+unsigned long long TreeSolver::solve_forest(const std::vector<int>& assigned, bool counting)
+{
+    /**
+     * the forest left by a cutset assignment. Returns the number of its solutions when counting, otherwise 1 if
+     * it has one (stored in first_solution) and 0 if not
+     */
+    const size_t n = names.size();
+
+    // the values of every forest variable that agree with the cutset
+    std::vector<std::vector<int>> domain(n);
+    for (size_t v = 0; v < n; v++)
+    {
+        if (in_cutset[v])
+        {
+            continue;
+        }
+        for (int value: values[v])
+        {
+            bool supported = true;
+            for (const auto& neighbour: neighbours[v])
+            {
+                if (in_cutset[neighbour.first] &&
+                    !compatible(neighbour.second, static_cast<int>(v), value, assigned[neighbour.first]))
+                {
+                    supported = false;
+                    break;
+                }
+            }
+            if (supported)
+            {
+                domain[v].push_back(value);
+            }
+        }
+        if (domain[v].empty())
+        {
+            return 0;
+        }
+    }
+
+    // root every tree at its smallest variable, parents before their children
+    std::vector<int> parent(n, -1);
+    std::vector<size_t> parent_edge(n, 0);
+    std::vector<int> forest_order;
+    std::vector<char> seen(n, 0);
+    for (size_t root = 0; root < n; root++)
+    {
+        if (in_cutset[root] || seen[root])
+        {
+            continue;
+        }
+        seen[root] = 1;
+        forest_order.push_back(static_cast<int>(root));
+        for (size_t next = forest_order.size() - 1; next < forest_order.size(); next++)
+        {
+            int v = forest_order[next];
+            for (const auto& neighbour: neighbours[v])
+            {
+                if (!in_cutset[neighbour.first] && !seen[neighbour.first])
+                {
+                    seen[neighbour.first] = 1;
+                    parent[neighbour.first] = v;
+                    parent_edge[neighbour.first] = neighbour.second;
+                    forest_order.push_back(neighbour.first);
+                }
+            }
+        }
+    }
+
+    if (counting)
+    {
+        // ways[v][k]: solutions of the subtree of v with v at its k-th value
+        std::vector<std::vector<unsigned long long>> ways(n);
+        for (size_t v = 0; v < n; v++)
+        {
+            ways[v].assign(domain[v].size(), 1);
+        }
+        unsigned long long total = 1;
+        for (auto it = forest_order.rbegin(); it != forest_order.rend(); ++it)
+        {
+            int child = *it;
+            int up = parent[child];
+            if (up < 0)
+            {
+                unsigned long long sum = 0;
+                for (unsigned long long way: ways[child])
+                {
+                    sum += way;
+                }
+                total *= sum;
+                continue;
+            }
+            for (size_t a = 0; a < domain[up].size(); a++)
+            {
+                unsigned long long sum = 0;
+                for (size_t b = 0; b < domain[child].size(); b++)
+                {
+                    if (compatible(parent_edge[child], up, domain[up][a], domain[child][b]))
+                    {
+                        sum += ways[child][b];
+                    }
+                }
+                ways[up][a] *= sum;
+            }
+        }
+        return total;
+    }
+
+    // directional arc consistency from the leaves up
+    for (auto it = forest_order.rbegin(); it != forest_order.rend(); ++it)
+    {
+        int child = *it;
+        int up = parent[child];
+        if (up < 0)
+        {
+            continue;
+        }
+        std::vector<int>& kept = domain[up];
+        kept.erase(std::remove_if(kept.begin(), kept.end(), [&](int a) {
+            return std::none_of(domain[child].begin(), domain[child].end(), [&](int b) {
+                return compatible(parent_edge[child], up, a, b);
+            });
+        }), kept.end());
+        if (kept.empty())
+        {
+            return 0;
+        }
+    }
+
+    // then pick the values from the roots down; every one has a support in its parent's value
+    first_solution = assigned;
+    for (int v: forest_order)
+    {
+        int up = parent[v];
+        for (int value: domain[v])
+        {
+            if (up < 0 || compatible(parent_edge[v], up, first_solution[up], value))
+            {
+                first_solution[v] = value;
+                break;
+            }
+        }
+    }
+    order.clear();
+    for (int v: cutset)
+    {
+        order.push_back(names[v]);
+    }
+    for (int v: forest_order)
+    {
+        order.push_back(names[v]);
+    }
+    return 1;
+}
@@ -0,0 +1,73 @@
+#ifndef CSP_TREE_SOLVER_HPP
+#define CSP_TREE_SOLVER_HPP
+
+#include "model.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * solver for networks of binary constraints whose graph is a forest or close to one. A forest is solved without
+ * search: directional arc consistency from the leaves to the roots leaves every value of a parent with a support in
+ * each child, so the values can then be picked from the roots down without ever failing, in O(n d^2). Otherwise a
+ * cycle cutset is removed first: every consistent assignment of the cutset leaves a forest to solve that way
+ */
+class TreeSolver {
+public:
+    // the variables of the cutset, then the variables of the forest from the roots down
+    std::vector<char> order;
+    // cutset assignments tried by the last solve or count
+    long long cutset_assignments = 0;
+
+    TreeSolver(const std::unordered_map<char, Domain>& variables, const std::vector<Constraint>& constraints)
+            : variables(variables), constraints(constraints)
+    {
+    }
+
+
+    bool prepare(size_t max_cutset, long long max_domain, std::string& reason);
+
+    bool solve(std::unordered_map<char, int>& solution);
+
+    unsigned long long count();
+
+
+    size_t cutset_size() const
+    {
+        return cutset.size();
+    }
+
+private:
+    struct Edge {
+        int first;
+        int second;
+        std::vector<Constraint> constraints;
+    };
+
+    const std::unordered_map<char, Domain>& variables;
+    const std::vector<Constraint>& constraints;
+    std::vector<char> names;
+    std::vector<int> index_of;
+    std::vector<std::vector<int>> values;
+    std::vector<Edge> edges;
+    // (neighbour, edge) of every variable
+    std::vector<std::vector<std::pair<int, size_t>>> neighbours;
+    std::vector<int> cutset;
+    std::vector<char> in_cutset;
+    std::vector<int> first_solution;
+
+
+    size_t edge_between(int u, int w) const;
+
+    bool compatible(size_t edge, int u, int a, int b) const;
+
+    void find_cutset();
+
+    void enumerate_cutset(size_t position, std::vector<int>& assigned, bool counting, unsigned long long& found);
+
+    unsigned long long solve_forest(const std::vector<int>& assigned, bool counting);
+};
+
+#endif
@@ -0,0 +1,875 @@
+#include "model.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * csp_codegen: compiles the constraints of a constraint file into the C++ source of a solver for that one model.
+ * The domains are still read when the generated solver runs, so one build serves every instance of the model.
+ * Every constraint becomes straight-line code over constant variable indices; the search keeps the variable and
+ * value ordering of backtrack_search, so the generated solver prints the same trace
+ */
+
+namespace {
+
+// the part of the generated solver that does not depend on the model: a binary constraint with its variables
+// compiled away, and the domains over the values read at run time
+const char* const runtime_types = R"CODE(#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+long long floor_div(long long a, long long b)
+{
+    long long q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+
+long long ceil_div(long long a, long long b)
+{
+    long long q = a / b;
+    return (a % b != 0 && ((a < 0) == (b < 0))) ? q + 1 : q;
+}
+
+
+// "var1 op coef * var2 + offset"
+struct Binary {
+    char op;
+    int coef;
+    int offset;
+
+
+    bool holds(long long value1, long long value2) const
+    {
+        long long right = static_cast<long long>(coef) * value2 + offset;
+        switch (op)
+        {
+            case '=': return value1 == right;
+            case '!': return value1 != right;
+            case '<': return value1 < right;
+            case '>': return value1 > right;
+            case 'L': return value1 <= right;
+            case 'G': return value1 >= right;
+            default: return false;
+        }
+    }
+
+
+    std::pair<long long, long long> supports(bool from_var1, long long lo, long long hi) const
+    {
+        if (!from_var1)
+        {
+            long long right_lo = coef > 0 ? coef * lo + offset : coef * hi + offset;
+            long long right_hi = coef > 0 ? coef * hi + offset : coef * lo + offset;
+            switch (op)
+            {
+                case '<': return {LLONG_MIN, right_hi - 1};
+                case 'L': return {LLONG_MIN, right_hi};
+                case '>': return {right_lo + 1, LLONG_MAX};
+                case 'G': return {right_lo, LLONG_MAX};
+                default: return {right_lo, right_hi};
+            }
+        }
+
+        long long product_lo = LLONG_MIN;
+        long long product_hi = LLONG_MAX;
+        switch (op)
+        {
+            case '<': product_lo = lo - offset + 1; break;
+            case 'L': product_lo = lo - offset; break;
+            case '>': product_hi = hi - offset - 1; break;
+            case 'G': product_hi = hi - offset; break;
+            default: product_lo = lo - offset; product_hi = hi - offset; break;
+        }
+        if (coef < 0)
+        {
+            std::swap(product_lo, product_hi);
+        }
+        long long first = product_lo == LLONG_MIN || product_lo == LLONG_MAX ? product_lo : ceil_div(product_lo, coef);
+        long long last = product_hi == LLONG_MIN || product_hi == LLONG_MAX ? product_hi : floor_div(product_hi, coef);
+        if (coef < 0)
+        {
+            first = first == LLONG_MAX ? LLONG_MIN : first;
+            last = last == LLONG_MIN ? LLONG_MAX : last;
+        }
+        return {first, last};
+    }
+
+
+    bool excluded_value(bool from_var1, long long value, long long& excluded) const
+    {
+        if (!from_var1)
+        {
+            excluded = static_cast<long long>(coef) * value + offset;
+            return true;
+        }
+        if ((value - offset) % coef != 0)
+        {
+            return false;
+        }
+        excluded = (value - offset) / coef;
+        return true;
+    }
+};
+
+
+// a domain never grows past the values it was read with, so it is a bitset over them. The general solver splits
+// larger domains instead of enumerating them, which this one does not do
+constexpr int max_values = 1024;
+constexpr int max_words = max_values / 64;
+
+struct Domain {
+    std::vector<int> values;
+    uint64_t bits[max_words] = {};
+    int words = 0;
+    int size = 0;
+
+
+    void assign(std::vector<int> sorted)
+    {
+        values = std::move(sorted);
+        size = static_cast<int>(values.size());
+        words = (size + 63) / 64;
+        std::fill(bits, bits + max_words, 0);
+        for (int index = 0; index < size; index++)
+        {
+            bits[index / 64] |= uint64_t{1} << (index % 64);
+        }
+    }
+
+
+    bool has(int index) const
+    {
+        return (bits[index / 64] >> (index % 64)) & 1;
+    }
+
+
+    int position(long long value) const
+    {
+        auto found = std::lower_bound(values.begin(), values.end(), value);
+        return found != values.end() && *found == value ? static_cast<int>(found - values.begin()) : -1;
+    }
+
+
+    bool contains(long long value) const
+    {
+        int index = position(value);
+        return index >= 0 && has(index);
+    }
+
+
+    void remove(long long value)
+    {
+        int index = position(value);
+        if (index >= 0 && has(index))
+        {
+            bits[index / 64] &= ~(uint64_t{1} << (index % 64));
+            size--;
+        }
+    }
+
+
+    long long count_range(long long lo, long long hi) const
+    {
+        if (lo > hi)
+        {
+            return 0;
+        }
+        int first = static_cast<int>(std::lower_bound(values.begin(), values.end(), lo) - values.begin());
+        int last = static_cast<int>(std::upper_bound(values.begin(), values.end(), hi) - values.begin());
+        long long count = 0;
+        for (int index = first; index < last;)
+        {
+            int word = index / 64;
+            int end = std::min(last, (word + 1) * 64);
+            uint64_t mask = bits[word] >> (index % 64);
+            int width = end - index;
+            if (width < 64)
+            {
+                mask &= (uint64_t{1} << width) - 1;
+            }
+            count += __builtin_popcountll(mask);
+            index = end;
+        }
+        return count;
+    }
+
+
+    int min() const
+    {
+        for (int word = 0; word < words; word++)
+        {
+            if (bits[word] != 0)
+            {
+                return values[word * 64 + __builtin_ctzll(bits[word])];
+            }
+        }
+        return 0;
+    }
+
+
+    int max() const
+    {
+        for (int word = words; word-- > 0;)
+        {
+            if (bits[word] != 0)
+            {
+                return values[word * 64 + 63 - __builtin_clzll(bits[word])];
+            }
+        }
+        return 0;
+    }
+
+
+    bool restrict(long long lo, long long hi)
+    {
+        int before = size;
+        int first = static_cast<int>(std::lower_bound(values.begin(), values.end(), lo) - values.begin());
+        int last = static_cast<int>(std::upper_bound(values.begin(), values.end(), hi) - values.begin());
+        auto drop = [&](int from, int to) {
+            for (int index = from; index < to; index++)
+            {
+                if (has(index))
+                {
+                    bits[index / 64] &= ~(uint64_t{1} << (index % 64));
+                    size--;
+                }
+            }
+        };
+        drop(0, first);
+        drop(std::max(first, last), static_cast<int>(values.size()));
+        return size != before;
+    }
+};
+
+
+// a domain as it was before forward checking changed it
+struct Saved {
+    int variable;
+    int size;
+    uint64_t bits[max_words];
+};
+
+)CODE";
+
+
+// the search, the trace and the entry point of the generated solver; they use the tables of the model
+// the state of the search and the trail of the domains
+const char* const runtime_state = R"CODE(
+Domain domains[variable_count];
+bool assigned[variable_count];
+int value_of[variable_count];
+int assigned_count = 0;
+std::vector<Saved> trail;
+
+bool forward_checking = false;
+bool count_all = false;
+long long solutions = 0;
+int branch = 0;
+std::vector<int> order;
+// the ranked values of every depth, so the search does not allocate
+std::vector<std::pair<int, long long>> ranked[variable_count];
+
+std::string out;
+
+
+void save_domain(int variable)
+{
+    const Domain& domain = domains[variable];
+    trail.emplace_back();
+    Saved& saved = trail.back();
+    saved.variable = variable;
+    saved.size = domain.size;
+    std::copy(domain.bits, domain.bits + domain.words, saved.bits);
+}
+
+
+void restore_domain(size_t mark)
+{
+    while (trail.size() > mark)
+    {
+        const Saved& saved = trail.back();
+        Domain& domain = domains[saved.variable];
+        domain.size = saved.size;
+        std::copy(saved.bits, saved.bits + domain.words, domain.bits);
+        trail.pop_back();
+    }
+}
+
+
+bool narrow_domain(int variable, long long lo, long long hi)
+{
+    Domain& domain = domains[variable];
+    if (domain.size == 0 || (domain.min() >= lo && domain.max() <= hi))
+    {
+        return false;
+    }
+    save_domain(variable);
+    return domain.restrict(lo, hi);
+}
+
+
+)CODE";
+
+
+// the search, the trace and the entry point of the generated solver; they use the functions of the model
+const char* const runtime_search = R"CODE(
+
+void flush()
+{
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+}
+
+
+void print_branch(bool failure, int value)
+{
+    out += std::to_string(branch);
+    out += ". ";
+    for (size_t j = 0; j < order.size(); j++)
+    {
+        if (j > 0)
+        {
+            out += ", ";
+        }
+        out += names[order[j]];
+        out += '=';
+        out += std::to_string(failure && j + 1 == order.size() ? value : value_of[order[j]]);
+    }
+    out += failure ? "  failure\n" : "  solution\n";
+    if (out.size() > (1 << 16))
+    {
+        flush();
+    }
+}
+
+
+int select_variable()
+{
+    /**
+     * the unassigned variable with the fewest values, then with the most constraints on unassigned variables, then
+     * the first by name
+     */
+    int best = -1;
+    int best_degree = -1;
+    for (int variable = 0; variable < variable_count; variable++)
+    {
+        if (assigned[variable] || domains[variable].size == 0)
+        {
+            continue;
+        }
+        if (best < 0 || domains[variable].size < domains[best].size)
+        {
+            best = variable;
+            best_degree = -1;
+            continue;
+        }
+        if (domains[variable].size == domains[best].size)
+        {
+            if (best_degree < 0)
+            {
+                best_degree = degree[best]();
+            }
+            int variable_degree = degree[variable]();
+            // the variables are numbered in the order of their names, so a tie keeps the earlier one
+            if (variable_degree > best_degree)
+            {
+                best = variable;
+                best_degree = variable_degree;
+            }
+        }
+    }
+    return best;
+}
+
+
+bool search()
+{
+    if (assigned_count == variable_count && all_hold())
+    {
+        branch++;
+        solutions++;
+        if (!count_all)
+        {
+            print_branch(false, 0);
+        }
+        return !count_all;
+    }
+
+    int variable = select_variable();
+    if (variable < 0)
+    {
+        return false;
+    }
+    order.push_back(variable);
+
+    // least constraining value first
+    std::vector<std::pair<int, long long>>& values = ranked[order.size() - 1];
+    values.clear();
+    const Domain& domain = domains[variable];
+    for (int index = 0; index < static_cast<int>(domain.values.size()); index++)
+    {
+        if (domain.has(index))
+        {
+            int value = domain.values[index];
+            values.emplace_back(value, ranking[variable](value));
+        }
+    }
+    std::sort(values.begin(), values.end(), [](const std::pair<int, long long>& a, const std::pair<int, long long>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    for (const auto& candidate: values)
+    {
+        int value = candidate.first;
+        if (!consistent[variable](value))
+        {
+            branch++;
+            if (!count_all)
+            {
+                print_branch(true, value);
+            }
+            continue;
+        }
+        size_t mark = trail.size();
+        if (forward_checking && !forward_check[variable](value))
+        {
+            continue;
+        }
+        assigned[variable] = true;
+        value_of[variable] = value;
+        assigned_count++;
+        if (search())
+        {
+            return true;
+        }
+        if (forward_checking)
+        {
+            restore_domain(mark);
+        }
+        assigned[variable] = false;
+        assigned_count--;
+    }
+    order.pop_back();
+    return false;
+}
+
+
+bool read_domains(const std::string& path)
+{
+    /**
+     * every line is "X: values" where a value is either a number or an inclusive range like 0..100. Every variable
+     * of the model needs a line, and no other variable may have one
+     */
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "error - cannot open " << path << "\n";
+        return false;
+    }
+    std::vector<bool> seen(variable_count, false);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream input_stream(line);
+        char var, colon;
+        std::string token;
+        if (!(input_stream >> var >> colon))
+        {
+            continue;
+        }
+        const char* found = std::find(names, names + variable_count, var);
+        if (found == names + variable_count)
+        {
+            std::cerr << "error - variable " << var << " is not part of the compiled model\n";
+            return false;
+        }
+        int variable = static_cast<int>(found - names);
+
+        std::vector<int> values;
+        while (input_stream >> token)
+        {
+            size_t dots = token.find("..");
+            try
+            {
+                long long lo = std::stoi(dots == std::string::npos ? token : token.substr(0, dots));
+                long long hi = dots == std::string::npos ? lo : std::stoi(token.substr(dots + 2));
+                if (hi - lo >= max_values)
+                {
+                    std::cerr << "error - variable " << var << " has more than " << max_values << " values\n";
+                    return false;
+                }
+                for (long long value = lo; value <= hi; value++)
+                {
+                    values.push_back(static_cast<int>(value));
+                }
+            }
+            catch (const std::exception&)
+            {
+                std::cerr << "error - cannot read value '" << token << "' of variable " << var << "\n";
+            }
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        if (values.size() > static_cast<size_t>(max_values))
+        {
+            std::cerr << "error - variable " << var << " has more than " << max_values << " values\n";
+            return false;
+        }
+        domains[variable].assign(std::move(values));
+        seen[variable] = true;
+    }
+    for (int variable = 0; variable < variable_count; variable++)
+    {
+        if (!seen[variable])
+        {
+            std::cerr << "error - variable " << names[variable] << " has no domain\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <path to variable file> <none|fc> [--count]\n";
+        return 1;
+    }
+    std::string mode = argv[2];
+    if (mode != "none" && mode != "fc")
+    {
+        std::cerr << "Invalid mode. Use 'none' or 'fc'." << std::endl;
+        return 1;
+    }
+    forward_checking = mode == "fc";
+    for (int arg = 3; arg < argc; arg++)
+    {
+        if (std::string(argv[arg]) == "--count")
+        {
+            count_all = true;
+        }
+        else
+        {
+            std::cerr << "error - unknown option " << argv[arg] << "\n";
+            return 1;
+        }
+    }
+    if (!read_domains(argv[1]))
+    {
+        return 1;
+    }
+
+    apply_unary();
+    search();
+    flush();
+    if (count_all)
+    {
+        std::cout << "solutions: " << static_cast<unsigned long long>(solutions) << std::endl;
+    }
+    return 0;
+}
+)CODE";
+
+
+std::string describe(const Constraint& constraint)
+{
+    std::ostringstream text;
+    text << constraint.var1 << " " << operator_symbol(constraint.op) << " ";
+    if (constraint.is_unary())
+    {
+        text << constraint.offset;
+    }
+    else
+    {
+        text << constraint.coef << "*" << constraint.var2 << " + " << constraint.offset;
+    }
+    return text.str();
+}
+
+
+void generate(std::ostream& out, const std::string& source, const std::vector<char>& names,
+              const std::vector<Constraint>& constraints)
+{
+    /**
+     * write the solver: the runtime types, the tables of the model, one function per variable and role with the
+     * constraints of the variable unrolled, and the search
+     */
+    std::vector<int> index_of(256, -1);
+    for (size_t variable = 0; variable < names.size(); variable++)
+    {
+        index_of[static_cast<unsigned char>(names[variable])] = static_cast<int>(variable);
+    }
+    auto index = [&](char name) {
+        return index_of[static_cast<unsigned char>(name)];
+    };
+
+    std::vector<size_t> binary;
+    std::vector<size_t> unary;
+    for (size_t c = 0; c < constraints.size(); c++)
+    {
+        (constraints[c].is_unary() ? unary : binary).push_back(c);
+    }
+    // for every variable its binary constraints, in the order of the file
+    std::vector<std::vector<size_t>> constraints_of(names.size());
+    for (size_t c: binary)
+    {
+        constraints_of[index(constraints[c].var1)].push_back(c);
+        if (constraints[c].var2 != constraints[c].var1)
+        {
+            constraints_of[index(constraints[c].var2)].push_back(c);
+        }
+    }
+
+    out << "// solver for the model of " << source << ", generated by csp_codegen\n"
+        << "// usage: <solver> <path to variable file> <none|fc> [--count]\n";
+    out << runtime_types;
+
+    out << "constexpr int variable_count = " << names.size() << ";\n";
+    out << "const char names[variable_count] = {";
+    for (size_t variable = 0; variable < names.size(); variable++)
+    {
+        out << (variable > 0 ? ", " : "") << "'" << names[variable] << "'";
+    }
+    out << "};\n\n";
+    for (size_t c = 0; c < constraints.size(); c++)
+    {
+        const Constraint& constraint = constraints[c];
+        out << "constexpr Binary c" << c << "{'" << constraint.op << "', " << constraint.coef << ", "
+            << constraint.offset << "};    // " << describe(constraint) << "\n";
+    }
+    out << runtime_state;
+
+    out << "\nvoid apply_unary()\n{\n";
+    for (size_t c: unary)
+    {
+        const Constraint& constraint = constraints[c];
+        int variable = index(constraint.var1);
+        out << "    {\n        constexpr Binary bound{'" << constraint.op << "', 0, " << constraint.offset << "};\n";
+        if (constraint.op == '!')
+        {
+            out << "        long long excluded = 0;\n"
+                << "        bound.excluded_value(false, 0, excluded);\n"
+                << "        if (excluded >= INT_MIN && excluded <= INT_MAX)\n        {\n"
+                << "            domains[" << variable << "].remove(excluded);\n        }\n";
+        }
+        else
+        {
+            out << "        std::pair<long long, long long> kept = bound.supports(false, 0, 0);\n"
+                << "        domains[" << variable << "].restrict(kept.first, kept.second);\n";
+        }
+        out << "    }\n";
+    }
+    out << "}\n\n";
+
+    out << "\nbool all_hold()\n{\n    return true";
+    for (size_t c: binary)
+    {
+        out << "\n        && c" << c << ".holds(value_of[" << index(constraints[c].var1) << "], value_of["
+            << index(constraints[c].var2) << "])";
+    }
+    out << ";\n}\n\n";
+
+    for (size_t variable = 0; variable < names.size(); variable++)
+    {
+        char name = names[variable];
+        // the variable against every assigned neighbour
+        out << "\n// " << name << "\nbool consistent_" << variable << "(int value)\n{\n";
+        for (size_t c: constraints_of[variable])
+        {
+            const Constraint& constraint = constraints[c];
+            if (constraint.var1 == constraint.var2)
+            {
+                // the variable itself is never assigned while its values are checked
+                continue;
+            }
+            bool first = constraint.var1 == name;
+            int other = index(first ? constraint.var2 : constraint.var1);
+            out << "    if (assigned[" << other << "] && !c" << c << ".holds("
+                << (first ? "value, value_of[" + std::to_string(other) + "]"
+                          : "value_of[" + std::to_string(other) + "], value") << "))\n    {\n"
+                << "        return false;\n    }\n";
+        }
+        out << "    return true;\n}\n\n";
+
+        out << "\nint degree_" << variable << "()\n{\n    return 0";
+        for (size_t c: constraints_of[variable])
+        {
+            const Constraint& constraint = constraints[c];
+            int other = index(constraint.var1 == name ? constraint.var2 : constraint.var1);
+            out << " + !assigned[" << other << "]";
+        }
+        out << ";\n}\n\n";
+
+        // how many values of the unassigned neighbours stay possible with variable = value
+        out << "\nlong long ranking_" << variable << "(int value)\n{\n    long long count = 0;\n";
+        for (size_t c: constraints_of[variable])
+        {
+            const Constraint& constraint = constraints[c];
+            bool first = constraint.var1 == name;
+            int other = index(first ? constraint.var2 : constraint.var1);
+            out << "    if (!assigned[" << other << "])\n    {\n";
+            if (constraint.op == '!')
+            {
+                out << "        long long excluded = 0;\n"
+                    << "        bool excludes = c" << c << ".excluded_value(" << (first ? "true" : "false") << ", value, excluded);\n"
+                    << "        count += domains[" << other << "].size - (excludes && excluded >= INT_MIN && "
+                    << "excluded <= INT_MAX && domains[" << other << "].contains(excluded) ? 1 : 0);\n";
+            }
+            else
+            {
+                out << "        std::pair<long long, long long> kept = c" << c << ".supports("
+                    << (first ? "true" : "false") << ", value, value);\n"
+                    << "        count += domains[" << other << "].count_range(kept.first, kept.second);\n";
+            }
+            out << "    }\n";
+        }
+        out << "    return count;\n}\n\n";
+
+        // remove the values of the unassigned neighbours that variable = value rules out
+        out << "\nbool forward_check_" << variable << "(int value)\n{\n"
+            << "    size_t mark = trail.size();\n";
+        std::vector<int> unassigned;
+        for (size_t c: constraints_of[variable])
+        {
+            const Constraint& constraint = constraints[c];
+            bool first = constraint.var1 == name;
+            unassigned.push_back(index(first ? constraint.var2 : constraint.var1));
+        }
+        // which neighbours are unassigned is decided before any domain changes
+        for (size_t k = 0; k < unassigned.size(); k++)
+        {
+            out << "    const bool open" << k << " = !assigned[" << unassigned[k] << "];\n";
+        }
+        for (size_t k = 0; k < constraints_of[variable].size(); k++)
+        {
+            size_t c = constraints_of[variable][k];
+            const Constraint& constraint = constraints[c];
+            bool first = constraint.var1 == name;
+            int other = unassigned[k];
+            out << "    if (open" << k << ")\n    {\n"
+                << "        if (domains[" << other << "].size == 0)\n        {\n"
+                << "            restore_domain(mark);\n            return false;\n        }\n";
+            if (constraint.op == '!')
+            {
+                out << "        long long excluded = 0;\n"
+                    << "        if (c" << c << ".excluded_value(" << (first ? "true" : "false") << ", value, excluded) && "
+                    << "excluded >= INT_MIN && excluded <= INT_MAX && domains[" << other << "].contains(excluded))\n"
+                    << "        {\n"
+                    << "            save_domain(" << other << ");\n"
+                    << "            domains[" << other << "].remove(excluded);\n"
+                    << "            if (domains[" << other << "].size == 0)\n            {\n"
+                    << "                restore_domain(mark);\n                return false;\n            }\n"
+                    << "        }\n";
+            }
+            else
+            {
+                out << "        std::pair<long long, long long> kept = c" << c << ".supports("
+                    << (first ? "true" : "false") << ", value, value);\n"
+                    << "        if (narrow_domain(" << other << ", kept.first, kept.second) && domains[" << other
+                    << "].size == 0)\n        {\n"
+                    << "            restore_domain(mark);\n            return false;\n        }\n";
+            }
+            out << "    }\n";
+        }
+        out << "    return true;\n}\n\n";
+    }
+
+    // the functions of every role indexed by variable
+    auto table = [&](const std::string& result, const std::string& name, const std::string& parameters) {
+        out << "\n" << result << " (* const " << name << "[])(" << parameters << ") = {";
+        for (size_t variable = 0; variable < names.size(); variable++)
+        {
+            out << (variable > 0 ? ", " : "") << name << "_" << variable;
+        }
+        out << "};\n";
+    };
+    table("bool", "consistent", "int");
+    table("int", "degree", "");
+    table("long long", "ranking", "int");
+    table("bool", "forward_check", "int");
+    out << runtime_search;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <path to constraint file> [<path to variable file>]\n"
+                  << "Writes the C++ source of a solver for the constraints of the file to standard output. The\n"
+                  << "variables are the ones of the constraints, and those of the variable file if one is given;\n"
+                  << "the generated solver reads the domains of an instance when it runs." << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file)
+    {
+        std::cerr << "error - cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<std::unique_ptr<Propagator>> propagators;
+    std::vector<std::string> errors;
+    std::vector<Constraint> constraints = parse_constraints(file, propagators, errors);
+    std::unordered_map<char, Domain> variables;
+    if (argc > 2)
+    {
+        variables = get_variables_from_file(argv[2], errors);
+    }
+    for (const auto& error: errors)
+    {
+        std::cerr << "error - " << error << std::endl;
+    }
+    if (!propagators.empty())
+    {
+        std::cerr << "error - " << propagators.front()->describe()
+                  << " is not a binary constraint; only binary and unary constraints can be compiled" << std::endl;
+        return 1;
+    }
+
+    std::vector<char> names;
+    for (const auto& constraint: constraints)
+    {
+        names.push_back(constraint.var1);
+        if (!constraint.is_unary())
+        {
+            names.push_back(constraint.var2);
+        }
+    }
+    for (const auto& variable: variables)
+    {
+        names.push_back(variable.first);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    if (names.empty())
+    {
+        std::cerr << "error - the model has no variables" << std::endl;
+        return 1;
+    }
+
+    generate(std::cout, argv[1], names, constraints);
+    return 0;
+}